@@ -0,0 +1,93 @@
+# pragma once
+
+#include "SortByLocTesterApp.hpp"
+#include "../include/printers.h"
+#include "../include/sorting.h"
+#include "../include/statistics.h"
+#include "../include/locchange.h"
+#include "../include/locationindex.h"
+#include "../include/gappedlocationindex.h"
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <fstream>
+
+using namespace sorting;
+using namespace printer;
+
+// per-tick update time of the three strategies at different change ratios (changes per tick / agents):
+//  CSR update (LocationIndex::apply, with compaction and with merge), gapped buckets (GappedLocationIndex::apply), sorting again from scratch
+class GappedIndexBenchmarkApp : public SortByLocTesterApp{
+    using time_unit_t = std::chrono::microseconds;
+
+    std::vector<double> _changeRatios = {0.001, 0.01, 0.05, 0.1, 0.33};
+    uint64_t _seed = 2020;
+    SortWorkspace _ws;
+
+public:
+    GappedIndexBenchmarkApp(int agentN){
+        __It = 5;                        // ticks per change ratio
+        __agentN = agentN;
+        __locN = __agentN / 3;
+        timesFile.open("times/locChanges/GAPPED_times_"+to_str(__agentN)+".txt");
+    }
+
+    void run(){
+        std::cout<<"agentN: "<<__agentN<<std::endl;
+        std::vector<int> agents(__agentN), locationOfAgent(__agentN);
+        init_vectors(agents, locationOfAgent, _seed);
+
+        std::vector<float> times_csr, times_merge, times_gapped, times_resort;
+        for(double ratio : _changeRatios){
+            int changeN = std::max(1, (int)(ratio * __agentN));
+            std::vector<int> locations = locationOfAgent;
+            LocationIndex csr(locations, __locN);
+            LocationIndex merged(locations, __locN, LocationIndex::UPDATE_MERGE);
+            GappedLocationIndex gapped(locations, __locN);
+
+            std::vector<float> t_csr, t_merge, t_gapped, t_resort;
+            for(int tick = 0; tick < __It; tick++){
+                std::vector<LocChange> changes = gen_loc_changes(locations, __locN, changeN, _seed, tick, _ws.buffer<uint64_t>(1, 0));  // sized by gen_loc_changes
+                for(const LocChange& lch : changes)
+                    locations[lch.agent] = lch.to;
+
+                auto t0 = std::chrono::high_resolution_clock::now();
+                csr.apply(changes);
+                auto t1 = std::chrono::high_resolution_clock::now();
+                merged.apply(changes);
+                auto t1m = std::chrono::high_resolution_clock::now();
+                gapped.apply(changes);
+                auto t2 = std::chrono::high_resolution_clock::now();
+                std::vector<int> sortedAgents(__agentN), sortedLocations = locations, locPtrs(__locN + 1);
+                std::iota(sortedAgents.begin(), sortedAgents.end(), 0);
+                auto t3 = std::chrono::high_resolution_clock::now();
+                sort_COUNTING_WITH_PTRS(sortedAgents, sortedLocations, locPtrs, _ws);
+                auto t4 = std::chrono::high_resolution_clock::now();
+
+                t_csr.push_back(std::chrono::duration_cast<time_unit_t>(t1 - t0).count());
+                t_merge.push_back(std::chrono::duration_cast<time_unit_t>(t1m - t1).count());
+                t_gapped.push_back(std::chrono::duration_cast<time_unit_t>(t2 - t1m).count());
+                t_resort.push_back(std::chrono::duration_cast<time_unit_t>(t4 - t3).count());
+
+                if(tick == __It - 1){
+                    std::vector<int> gAgents, gLocations, gLocPtrs;
+                    gapped.to_csr(gAgents, gLocations, gLocPtrs);
+                    std::cout << "ratio " << ratio << "\teq_csr: " << (csr.agents() == sortedAgents && csr.locPtrs() == locPtrs)
+                              << "\teq_merge: " << (merged.agents() == sortedAgents && merged.locations() == sortedLocations && merged.locPtrs() == locPtrs)
+                              << "\teq_gapped: " << (gAgents == sortedAgents && gLocPtrs == locPtrs)
+                              << "\trebalances: " << gapped.rebalances() << "\trebuilds: " << gapped.rebuilds() << std::endl;
+                }
+            }
+            times_csr.push_back(avg(t_csr));
+            times_merge.push_back(avg(t_merge));
+            times_gapped.push_back(avg(t_gapped));
+            times_resort.push_back(avg(t_resort));
+        }
+        to_file(_changeRatios, timesFile, "changeRatios = ");
+        to_file(times_csr, timesFile, "times_csr_us = ");
+        to_file(times_merge, timesFile, "times_merge_us = ");
+        to_file(times_gapped, timesFile, "times_gapped_us = ");
+        to_file(times_resort, timesFile, "times_resort_us = ");
+    }
+};
@@ -3,6 +3,9 @@
 #include "SortByLocTesterApp.hpp"
 #include "../include/printers.h"
 #include "../include/sorting.h"
+#include "../include/compaction.h"
+#include "../include/locationindex.h"
+#include "../include/twolevelindex.h"
 
 
 #ifndef GPU
@@ -32,19 +35,16 @@ using namespace printer;
 class LocChangeHandlingApp : public SortByLocTesterApp{
     using time_unit_t = std::chrono::milliseconds;
 public:
-    struct LocChange{
-        int agent;
-        int from; // from location ID
-        int to;   // to location ID
-        LocChange() : agent(-1), from(-1), to(-1){}
-        LocChange(int agent_, int from_, int to_) : agent(agent_), from(from_), to(to_){}
-        void PRINT(){ std::cout << agent << "\t[ " << from << "\t" << to << " ]\n"; }
-    };
+    using LocChange = ::LocChange;
     struct Times{
         std::vector<int> times_sortAgain;
+        std::vector<int> times_sortAgainPacked64;  // sorting again as packed 64 bit (location, agent) keys, radix
+        std::vector<int> times_sortAgainAdaptive;  // re-sorting the previous grouping, where only the movers are out of order
         std::vector<int> times_refreshLocPtrs;
         std::vector<int> times_refreshAgents;
         std::vector<int> times_refreshLocations;
+        std::vector<int> times_refreshTwoLevel;    // (location, state) grouping: the same LocChanges + state changes
+        std::vector<int> times_sortAgainTwoLevel;
         std::vector<int> getFullUpdateTime(){
             std::vector<int> times(times_refreshLocPtrs.size());
             for(int i = 0; i<times.size(); i++){
@@ -60,16 +60,29 @@ private:
     std::vector<int> _agents_sbA; // sbA = sorted by _agents
     std::vector<int> _locations_sbA;
 
+    LocationIndex _index;  // the grouping updated by the LocChanges
+
+    int _stateN = 4;                 // e.g. infection states
+    std::vector<int> _states_sbA;    // state of every agent
+    TwoLevelIndex _twoLevelIndex;    // agents grouped by 1. location 2. state, updated next to _index
+
+    // reference grouping: sorted again from scratch
     std::vector<int> _agents;
     std::vector<int> _locations;
     std::vector<int> _locPtrs; 
 
-    std::vector<int> _locInds;
-    std::vector<int> _agentInds;
-    std::vector<int> _changeInds;
+    uint64_t _seed = 2020;  // workload seed - same seed, same LocChanges
+    uint64_t _tick = 0;
+
+    SortWorkspace _ws;  // scratch buffers of the sorts and of update_agents, kept between the calls
 
     Times _times;
 
+    // LocationIndex::UpdateTimes are in ns
+    static int to_ms(long int ns){
+        return std::chrono::duration_cast<time_unit_t>(LocationIndex::time_unit_t(ns)).count();
+    }
+
 public:
     LocChangeHandlingApp(int agentN){
         __range = SortByLocTesterApp::genRange();
@@ -78,68 +91,41 @@ public:
         __locN = __agentN / 3;               // number of distinct _locations (number of _locations in the COVID simulator)
         _locChangeN = __agentN / 3; //__agentN / 3;
 
-        _locInds = std::vector<int>(__locN);
-        std::iota(_locInds.begin(), _locInds.end(), 0);
-        _agentInds = std::vector<int>(__agentN);
-        std::iota(_agentInds.begin(), _agentInds.end(), 0);
-        _changeInds = std::vector<int>(_locChangeN);
-        std::iota(_changeInds.begin(), _changeInds.end(), 0);
-        
         _agents_sbA = std::vector<int>(__agentN); // sbA = sorted by _agents
         _locations_sbA = std::vector<int>(__agentN);
-        init_vectors(_agents_sbA, _locations_sbA);
+        init_vectors(_agents_sbA, _locations_sbA, _seed);
 
-        _locChanges = genLocChanges(_locations_sbA); 
+        _locChanges = genLocChanges(_locations_sbA, _seed, _tick); 
 
         _agents = std::vector<int>(__agentN);
         _locations = std::vector<int>(__agentN);
         _locPtrs = std::vector<int>(__locN+1);
-        std::copy(std::execution::par, _agents_sbA.begin(), _agents_sbA.end(), _agents.begin());
-        std::copy(std::execution::par, _locations_sbA.begin(), _locations_sbA.end(), _locations.begin());
 
-        // sort
-        sort_MY_PAIR(_agents, _locations);
-        generateKeyPtrs(_locations, _locPtrs);
+        _index.build(_locations_sbA, __locN);
+        _index.set_update_alg(LocationIndex::UPDATE_COMPACTION);  // the incremental update this app measures
+        initTwoLevel();
     }
 
-    std::vector<LocChange> genLocChanges(std::vector<int> locations_sortedByAgents){
-        std::vector<LocChange> locChanges;
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<int> distrb_agent(0, __agentN-1);
-        std::uniform_int_distribution<int> distrb_loc(0, __locN-1);
-        for(int i = 0; i < _locChangeN; i++){
-            LocChange tmpLocChange(0,0,0);
-            // gen agent
-            do{
-                tmpLocChange.agent = distrb_agent(gen);
-            } while( std::find_if(std::execution::par, locChanges.begin(), locChanges.end(), [=](LocChange lch){ return tmpLocChange.agent == lch.agent; }) != locChanges.end());
-            // fill from
-            tmpLocChange.from = locations_sortedByAgents[tmpLocChange.agent];
-            // gen to
-            do
-                tmpLocChange.to = distrb_loc(gen);
-            while( tmpLocChange.to == locations_sortedByAgents[tmpLocChange.agent]
-                    || std::find_if(std::execution::par, locChanges.begin(), locChanges.end(), [=](LocChange lch){ return tmpLocChange.agent == lch.agent; }) != locChanges.end());
-            
-            locChanges.push_back(tmpLocChange);
-        }
-        locChanges = sortLocChanges(locChanges);
-        return locChanges;
+    // deterministic and parallel: the same seed and tick give the same LocChanges (see gen_loc_changes)
+    std::vector<LocChange> genLocChanges(const std::vector<int>& locations_sortedByAgents, uint64_t seed, uint64_t tick){
+        return gen_loc_changes(locations_sortedByAgents, __locN, _locChangeN, seed, tick, _ws.buffer<uint64_t>(0, 0));  // sized by gen_loc_changes
     }
 
     std::vector<LocChange> sortLocChanges(std::vector<LocChange> locChanges){                                  
         // update_agents ::  movingAgents_toInds  wants it:
         // 1. toInd  2. agent
-        std::sort(std::execution::par, locChanges.begin(), locChanges.end(), [](LocChange lch1, LocChange lch2){
-            if(lch1.to != lch2.to)
-                return lch1.to < lch2.to;
-            return lch1.agent < lch2.agent;
-        });
+        LocationIndex::sort_changes(locChanges);
         return locChanges;
     }
 
 
+    // random states (drawn like the initial locations), grouped with the current locations
+    void initTwoLevel(){
+        _states_sbA = std::vector<int>(__agentN);
+        gen_locations(_states_sbA, _stateN, _seed + 1);
+        _twoLevelIndex.build(_locations_sbA, _states_sbA, __locN, _stateN);
+    }
+
     ///////////////////////////////////////  Test case init  //////////////////////////////////////////////////////////////////
     void initTestCase(){
         std::vector<int> agents, locations;
@@ -182,39 +168,28 @@ public:
         __locN = 3;
         _locChangeN = 3;
 
-        // locInds, agentInds
-        _locInds = std::vector<int>(__locN);
-        std::iota(_locInds.begin(), _locInds.end(), 0);
-        _agentInds = std::vector<int>(__agentN);
-        std::iota(_agentInds.begin(), _agentInds.end(), 0);
-        _changeInds = std::vector<int>(_locChangeN);
-        std::iota(_changeInds.begin(), _changeInds.end(), 0);
-        
         // sorted by agents
-        sort_MY_PAIR(locations, agents); 
+        sort_MY_PAIR(locations, agents, _ws); 
         _agents_sbA = agents;
         _locations_sbA = locations;
 
-        // init locChanges
-        _locChanges = initLocChanges(lchs); // {agentID, toInd}
         // _agents, _locations, _locPtrs
         _agents = std::vector<int>(__agentN);
         _locations = std::vector<int>(__agentN);
         _locPtrs = std::vector<int>(__locN+1);
-        std::copy(std::execution::par, _agents_sbA.begin(), _agents_sbA.end(), _agents.begin());
-        std::copy(std::execution::par, _locations_sbA.begin(), _locations_sbA.end(), _locations.begin());
-        // sort
-        sort_MY_PAIR(_agents, _locations);
-        generateKeyPtrs(_locations, _locPtrs);
 
-        
+        _index.build(_locations_sbA, __locN);
+        _index.set_update_alg(LocationIndex::UPDATE_COMPACTION);  // the incremental update this app measures
+        initTwoLevel();
+
+        // init locChanges
+        _locChanges = initLocChanges(lchs); // {agentID, toInd}
     }
 
     std::vector<LocChange> initLocChanges(int (&lchs)[3][2]){
         std::vector<LocChange> locChanges;
         for(int i = 0; i < 3; i++){
-            int ind = std::distance(_agents_sbA.begin(), std::lower_bound(_agents_sbA.begin(), _agents_sbA.end(), lchs[i][0]));
-            LocChange lch(lchs[i][0], _locations_sbA[ind], lchs[i][1]);
+            LocChange lch(lchs[i][0], _index.location_of(lchs[i][0]), lchs[i][1]);
             locChanges.push_back(lch);
         }
 
@@ -237,17 +212,33 @@ public:
                 ////std::cout<<"\n";
                 
 
-                update_locations_sbA(); // it is not in full time measure
-                update_agents();
-                update_locPtrs();
-                update_locations();
+                std::vector<int> _agentsPrev = _index.agents();  // previous grouping - input of the adaptive re-sort
 
-
-                
-                // save UPDATE METHOD results
-                std::vector<int> _agentsU = _agents;
-                std::vector<int> _locationsU = _locations;
-                std::vector<int> _locPtrsU = _locPtrs; 
+                update_locations_sbA(); // it is not in full time measure
+                LocationIndex::UpdateTimes updateTimes = _index.apply(_locChanges);
+                _times.times_refreshAgents.push_back(to_ms(updateTimes.agents));
+                _times.times_refreshLocPtrs.push_back(to_ms(updateTimes.locPtrs));
+                _times.times_refreshLocations.push_back(to_ms(updateTimes.locations));
+
+                // validate UPDATE METHOD: invariants + order-independent hash against _locations_sbA, no copies, no re-sort
+                auto t_verify_begin = std::chrono::high_resolution_clock::now();
+                LocationIndex::Verification verification = _index.verify(_locations_sbA);
+                auto t_verify_end = std::chrono::high_resolution_clock::now();
+
+                // two-level grouping: the same LocChanges + a tenth of the agents changing state, vs sorting again
+                std::vector<LocChange> stateChanges = gen_loc_changes(_states_sbA, _stateN, std::max(1, __agentN / 10), _seed + 1, _tick,
+                                                                      _ws.buffer<uint64_t>(0, 0));
+                for(const LocChange& sch : stateChanges)
+                    _states_sbA[sch.agent] = sch.to;
+                auto t_twoLevel_begin = std::chrono::high_resolution_clock::now();
+                _twoLevelIndex.apply(_locChanges, stateChanges);
+                auto t_twoLevel_end = std::chrono::high_resolution_clock::now();
+                _times.times_refreshTwoLevel.push_back(std::chrono::duration_cast<time_unit_t>(t_twoLevel_end - t_twoLevel_begin).count());
+                std::vector<int> agentsTwoLevel(__agentN), locationsTwoLevel = _locations_sbA, statesTwoLevel = _states_sbA;
+                std::vector<int> nestedPtrs(__locN * _stateN + 1);
+                std::iota(agentsTwoLevel.begin(), agentsTwoLevel.end(), 0);
+                _times.times_sortAgainTwoLevel.push_back(sort_TWO_LEVEL(agentsTwoLevel, locationsTwoLevel, statesTwoLevel, _stateN, nestedPtrs, _ws));
+                bool eq_twoLevel = _twoLevelIndex.agents() == agentsTwoLevel && _twoLevelIndex.nestedPtrs() == nestedPtrs;
 
                 std::cout << "\n////////////// UPDATED //////////////\n";
                 ////PRINT_all();
@@ -256,26 +247,71 @@ public:
                 // ... vs sort again
                 std::copy(std::execution::par, _agents_sbA.begin(), _agents_sbA.end(), _agents.begin());
                 std::copy(std::execution::par, _locations_sbA.begin(), _locations_sbA.end(), _locations.begin());
-                float time_sort = sort_MY_PAIR(_agents, _locations);
+                float time_sort = sort_MY_PAIR(_agents, _locations, _ws);
                 float time_gen_locPtrs = generateKeyPtrs(_locations, _locPtrs);
                 int time_sortAgain = time_sort + time_gen_locPtrs;
                 _times.times_sortAgain.push_back(time_sortAgain);
                 std::cout << "\n////////////// SORTED ///////////////\n";
+
+                // ... vs sort again as packed 64 bit keys
+                std::vector<int> agentsPacked = _agents_sbA, locationsPacked = _locations_sbA;
+                float time_sortPacked = sort_PACKED64_RADIX(agentsPacked, locationsPacked, _ws);
+                float time_gen_locPtrsPacked = generateKeyPtrs(locationsPacked, _locPtrs, KEYPTRS_BOUNDARY_SCAN);
+                _times.times_sortAgainPacked64.push_back(time_sortPacked + time_gen_locPtrsPacked);
+                bool eq_packed64 = agentsPacked == _agents && locationsPacked == _locations;
                 ////PRINT_all();
 
-                // validate UPDATE METHOD
-                bool eq_agents    = _agentsU == _agents;
-                bool eq_locations = _locationsU == _locations;
-                bool eq_locPtrs   = _locPtrsU == _locPtrs;
-                std::cout << "\neq_agents: \t" << eq_agents << std::endl;
-                std::cout <<   "eq_locations: \t" << eq_locations << std::endl;
-                std::cout <<   "eq_locPtrs: \t" << eq_locPtrs << std::endl;
+                // ... vs sort again adaptively: the previous grouping with the new locations is sorted except the movers
+                std::vector<int> _locationsPrev(__agentN);
+                std::transform(std::execution::par, _agentsPrev.begin(), _agentsPrev.end(), _locationsPrev.begin(), [this](int agent){
+                    return _locations_sbA[agent];
+                });
+                float time_sortAdaptive = sort_ADAPTIVE(_agentsPrev, _locationsPrev, _ws);
+                float time_gen_locPtrsAdaptive = generateKeyPtrs(_locationsPrev, _locPtrs, KEYPTRS_BOUNDARY_SCAN);
+                _times.times_sortAgainAdaptive.push_back(time_sortAdaptive + time_gen_locPtrsAdaptive);
+                bool eq_adaptive = _agentsPrev == _agents && _locationsPrev == _locations;
+
+                bool verify_doubleBuffered = checkDoubleBuffered(_locations_sbA);
+
+                std::cout << "\nverify_locPtrs: \t" << verification.locPtrs << std::endl;
+                std::cout <<   "verify_segments: \t" << verification.segments << std::endl;
+                std::cout <<   "verify_permutation: \t" << verification.permutation << std::endl;
+                std::cout <<   "verify_contents: \t" << verification.contents << std::endl;
+                std::cout <<   "verify time: \t" << std::chrono::duration_cast<time_unit_t>(t_verify_end - t_verify_begin).count() << " ms" << std::endl;
+                std::cout <<   "eq_packed64: \t" << eq_packed64 << std::endl;
+                std::cout <<   "eq_twoLevel: \t" << eq_twoLevel << std::endl;
+                std::cout <<   "eq_adaptive: \t" << eq_adaptive << std::endl;
+                std::cout <<   "verify_doubleBuffered: \t" << verify_doubleBuffered << std::endl;
 
             }
         }
         return _times;
     }
 
+    // double buffered mode: a few ticks of every strategy (the back buffers are brought up to date from the previous tick, also
+    // across a re-sort), verified and compared with a single buffered twin after every tick
+    bool checkDoubleBuffered(const std::vector<int>& locationOfAgent, int ticksPerAlg = 4){
+        LocationIndex doubleBuffered(locationOfAgent, __locN), singleBuffered(locationOfAgent, __locN);
+        doubleBuffered.set_double_buffered(true);
+        std::vector<int> expected = locationOfAgent;
+        uint64_t tick = 0;
+        bool ok = true;
+        for(LocationIndex::UpdateAlg alg : {LocationIndex::UPDATE_COMPACTION, LocationIndex::UPDATE_MERGE, LocationIndex::UPDATE_RESORT, LocationIndex::UPDATE_COMPACTION}){
+            doubleBuffered.set_update_alg(alg);
+            singleBuffered.set_update_alg(alg);
+            for(int k = 0; k < ticksPerAlg; k++){
+                std::vector<LocChange> changes = genLocChanges(expected, _seed + 2, tick++);
+                for(const LocChange& lch : changes)
+                    expected[lch.agent] = lch.to;
+                doubleBuffered.apply(changes);
+                singleBuffered.apply(changes);
+                ok = ok && doubleBuffered.verify(expected).ok() && doubleBuffered.agents() == singleBuffered.agents()
+                        && doubleBuffered.locations() == singleBuffered.locations() && doubleBuffered.locPtrs() == singleBuffered.locPtrs();
+            }
+        }
+        return ok;
+    }
+
 /*   //  trying to write with primitive array - problem: how to copy the whole array to the GPU?
     void update_locations_sbA(){
         std::cout << "//// upd loc_SbA ////////\n";
@@ -303,168 +339,6 @@ public:
         std::cout << "//// upd loc_SbA END ////////\n";
     }
     
-        
-    void update_locPtrs(){ /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-        std::cout << "//// upd locPtrs ////////\n";
-        auto t_locPtrs_begin = std::chrono::high_resolution_clock::now();
-        std::for_each(std::execution::par, _locInds.begin(), _locInds.end(), [&](int i){
-            _locPtrs[i] -= std::count_if(std::execution::par, _locChanges.begin(), _locChanges.end(), [&](LocChange lch){
-                return lch.from < i;
-            });
-            _locPtrs[i] += std::count_if(std::execution::par, _locChanges.begin(), _locChanges.end(), [&](LocChange lch){
-                return lch.to < i;
-            });
-        });
-        auto t_locPtrs_end = std::chrono::high_resolution_clock::now();
-
-        int time_refreshLocPtrs = std::chrono::duration_cast<time_unit_t>( t_locPtrs_end - t_locPtrs_begin ).count();
-        _times.times_refreshLocPtrs.push_back(time_refreshLocPtrs);
-        std::cout << "//// upd locPtrs END ////////\n";
-    }
-
-    int calcShift_forInsertion (const int &beginInd, const int &toInd, const std::vector<std::pair<int,int>> &movingAgents_toInds){ // shouldn't throw segfault
-        int shift = std::count_if(movingAgents_toInds.begin(), movingAgents_toInds.end(), [&](std::pair<int,int> agent_ind){
-            return beginInd <= agent_ind.second  && agent_ind.second <= toInd;
-        });
-        if(shift != 0)
-            shift = shift + calcShift_forInsertion(toInd+1, toInd + shift, movingAgents_toInds);
-        return shift;
-    };
-    void update_agents(){ ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-        std::cout << "//// upd agents ////////\n";
-
-        // HELPER arrays
-        std::vector<std::pair<int,int>> staticAgents_inds(__agentN - _locChangeN);
-        std::vector<std::pair<int,int>> movingAgents_fromInds(_locChangeN);
-        std::vector<std::pair<int,int>> movingAgents_toInds(_locChangeN);
-
-        std::vector<int> movingAgents(_locChangeN);
-        std::vector<std::pair<int,int>> agents_oldInds(__agentN);
-        std::vector<int> locPtrs_stat(__locN + 1);
-        std::vector<int> locPtrs_shifts(__locN + 1, 0);
-
-        ////////////// for DEBUG purpuse ////////////////
-        std::fill(staticAgents_inds.begin(), staticAgents_inds.end(), std::make_pair<int,int>(-1,-1));
-        std::fill(movingAgents_fromInds.begin(), movingAgents_fromInds.end(), std::make_pair<int,int>(-1,-1));
-        std::fill(movingAgents_toInds.begin(), movingAgents_toInds.end(), std::make_pair<int,int>(-1,-1));
-
-        // ----------------------- START time measuring -------------------------------------
-        auto t_agents2_begin = std::chrono::high_resolution_clock::now();
-
-        // init movingAgents_fromInds, movingAgents
-        std::for_each(std::execution::seq /*TODO - it is working just in seq for any reason on CPU as well.*/, _changeInds.begin(), _changeInds.end(), [this, &movingAgents_fromInds, &movingAgents](int i){
-            auto ptr = std::lower_bound(_agents.begin() + _locPtrs[_locChanges[i].from], _agents.begin() + _locPtrs[_locChanges[i].from + 1], _locChanges[i].agent);  // must exist accurately
-            
-            ////std::for_each(_agents.begin() + _locPtrs[_locChanges[i].from], _agents.begin() + _locPtrs[_locChanges[i].from + 1], [](int i){ std::cout << i << " ";});
-            ////std::cout <<"\n to find: \t"<< _locChanges[i].agent << "\n";
-            ////std::cout <<"it points to: \t" <<*ptr<<std::endl;
-
-            int fromInd = std::distance(_agents.begin(), ptr);
-            movingAgents_fromInds[i] = std::make_pair(_locChanges[i].agent, fromInd);
-            movingAgents[i] = _locChanges[i].agent;
-        });
-        ////PRINT_vector(movingAgents_fromInds, "first", "Moving agents:    ");
-        ////PRINT_vector(movingAgents_fromInds, "second", "mvAgs_fromInds:  ");
-        
-        // TODO: ? is it needed indead? (isnt enough to go throw by indexes in parallel loops?)
-        // init agents_oldInds
-        std::for_each(std::execution::par, _agentInds.begin(), _agentInds.end(), [&](int i){
-            agents_oldInds[i] = std::make_pair(_agents[i], i);
-        });
-
-        // (DELETION) staticAgents_inds = agents_oldInds - "moving Agents"  
-        std::for_each(std::execution::seq /*TODO - it is working just in seq for any reason on CPU as well.*/, agents_oldInds.begin(), agents_oldInds.end(), [this, &movingAgents, &movingAgents_fromInds, &staticAgents_inds](std::pair<int,int> agent_oldInd){
-            if(std::binary_search(movingAgents.begin(), movingAgents.end(), agent_oldInd.first))
-                return;
-            int shiftLeft = std::count_if(std::execution::par, movingAgents_fromInds.begin(), movingAgents_fromInds.end(), [&](std::pair<int, int> mvAgent_fromInd){
-                return mvAgent_fromInd.second < agent_oldInd.second; // shouldnt be equal because than it is filterd out above
-            });
-            std::pair<int,int> newStatAgent_ind;
-            newStatAgent_ind.first  = agent_oldInd.first;
-            newStatAgent_ind.second = agent_oldInd.second - shiftLeft;
-            staticAgents_inds[newStatAgent_ind.second] = newStatAgent_ind;
-            ////std::cout << "agent  : " << agent_oldInd.first << std::endl;
-            ////std::cout << "oldInd : " << agent_oldInd.second << std::endl;
-            ////std::cout << "newInd : " << agent_oldInd.second - shiftLeft << std::endl;
-            ////std::cout << std::endl;
-        });
-        ////PRINT_vector(staticAgents_inds, "first" , "statAg:      ");
-
-
-        // create locPtrs for staticAgents_inds    // TODO GPU: one of the nested loops to seq
-        std::for_each(std::execution::par, _locInds.begin(), _locInds.end(), [this, &locPtrs_shifts](int loc){
-            locPtrs_shifts[loc + 1] = std::count_if(std::execution::par, _locChanges.begin(), _locChanges.end(), [&loc](LocChange lch){
-                return lch.from == loc;
-            }); 
-        });
-        std::inclusive_scan(std::execution::par, locPtrs_shifts.begin(), locPtrs_shifts.end(), locPtrs_shifts.begin());
-        std::transform(std::execution::par, _locPtrs.begin(), _locPtrs.end(), locPtrs_shifts.begin(), locPtrs_stat.begin(), [](int lPtr, int shift){
-            return lPtr - shift;  // shouldn't throw segfault
-        });
-        ////PRINT_vector(locPtrs_stat, "locPtrs_stat:  ");
-
-        /* trying to write it without nested loop
-        // create locPtrs for staticAgents_inds 
-        std::vector<int> locPtrs_stat(__locN + 1);
-        std::vector<int> locPtrs_shiftLefts(__locN + 1, 0);
-        std::vector<int> isMovedFromIthLoc(__locN * _locChangeN, 0); // plain matrix, rows: locations, colummns: in ith locChange  from_loc == ithLoc
-        std::vector<int> mxInds(__locN * _locChangeN);
-        std::iota(mxInds.begin(), mxInds.end(), 0);
-// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-        std::for_each(std::execution::par, mxInds.begin(), mxInds.end(), [this, &isMovedFromIthLoc](int ind){
-            isMovedFromIthLoc[ind] = 0;
-        });
-// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-        std::inclusive_scan(std::execution::par, isMovedFromIthLoc.begin(), isMovedFromIthLoc.end(), locPtrs_shiftLefts.begin());
-        std::transform(std::execution::par, _locPtrs.begin(), _locPtrs.end(), locPtrs_shiftLefts.begin(), locPtrs_stat.begin(), [](int lPtr, int shift){
-            return lPtr - shift;  // shouldn't throw segfault
-        });
-        ////PRINT_vector(locPtrs_stat, "locPtrs_stat:  ");
-        */
-
-        // movingAgents_toInds  (not intent)   !!! : locChanges must be sorted by toInds!
-        std::for_each(std::execution::par, _changeInds.begin(), _changeInds.end(), [this, &movingAgents_toInds, &staticAgents_inds, &locPtrs_stat](int i){
-            auto ptr = std::lower_bound(staticAgents_inds.begin() + locPtrs_stat[_locChanges[i].to], staticAgents_inds.begin() + locPtrs_stat[_locChanges[i].to + 1], _locChanges[i].agent, [&](std::pair<int,int> agent_ind, int agent){
-                return agent_ind.first < agent;
-            });  // shouldn't exist accuratelly
-            int toInd = std::distance(staticAgents_inds.begin(), ptr);
-            movingAgents_toInds[i] = std::make_pair(_locChanges[i].agent, toInd + i);   // locChanges is sorted by 1. toLocation 2. agnetID   =>   movingAgents_toInds is sorted by 1. inds 2. agents
-                                                                                        // +i is because of the "self shift"
-        });     
-        ////PRINT_vector(movingAgents_toInds, "first",  "mvAg:         ");
-        ////PRINT_vector(movingAgents_toInds, "second", "TO ind:  ");
-
-        // (INSERTION) Insert staticAgents into _agents
-        std::for_each(std::execution::par, staticAgents_inds.begin(), staticAgents_inds.end(), [&](std::pair<int,int> agent_ind){
-            int shiftRigth = calcShift_forInsertion(0, agent_ind.second, movingAgents_toInds);
-            _agents[agent_ind.second + shiftRigth] = agent_ind.first;
-        });
-
-        // Insert movingAgents into _agents
-        std::for_each(std::execution::par, movingAgents_toInds.begin(), movingAgents_toInds.end(), [&](std::pair<int,int> agent_ind){
-            _agents[agent_ind.second] = agent_ind.first;
-        });
-
-        auto t_agents2_end = std::chrono::high_resolution_clock::now();
-
-        int time_refreshAgents2 = std::chrono::duration_cast<time_unit_t>( t_agents2_end - t_agents2_begin ).count();
-        _times.times_refreshAgents.push_back(time_refreshAgents2);
-        std::cout << "//// upd agents END ////////\n";
-    }
-
-        
-    void update_locations(){ /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-        std::cout << "//// upd locs ////////\n";
-        auto t_locations_begin = std::chrono::high_resolution_clock::now();
-        std::for_each(std::execution::par, _locInds.begin(), _locInds.end(), [this](int i){
-            std::fill(std::execution::par, _locations.begin()+_locPtrs[i], _locations.begin()+_locPtrs[i+1], i);  
-        }); 
-        auto t_locations_end = std::chrono::high_resolution_clock::now();
-
-        int time_refreshLocations = std::chrono::duration_cast<time_unit_t>( t_locations_end - t_locations_begin ).count();
-        _times.times_refreshLocations.push_back(time_refreshLocations);
-        std::cout << "//// upd locs END ////////\n";
-    }
 
 
     void PRINT_locChanges(){
@@ -477,9 +351,9 @@ public:
     void PRINT_all(){
         PRINT_vector(_agents_sbA, "_agents_sbA");
         PRINT_vector(_locations_sbA, "_locations_sbA");
-        PRINT_vector(_locPtrs,  "_locPtrs :    ");
-        PRINT_vector(_agents,   "_agents :     ");
-        PRINT_vector(_locations,"_locations :  ");
+        PRINT_vector(_index.locPtrs(),  "_locPtrs :    ");
+        PRINT_vector(_index.agents(),   "_agents :     ");
+        PRINT_vector(_index.locations(),"_locations :  ");
         PRINT_locChanges();
     }
 
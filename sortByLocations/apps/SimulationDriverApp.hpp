@@ -0,0 +1,226 @@
+# pragma once
+
+#include "SortByLocTesterApp.hpp"
+#include "../include/printers.h"
+#include "../include/statistics.h"
+#include "../include/locchange.h"
+#include "../include/locationindex.h"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <fstream>
+
+using namespace printer;
+
+// steady state of one LocationIndex over many ticks: every tick a fresh batch of changeRatio * agentN LocChanges
+// (gen_loc_changes, deterministic in (seed, tick)) is applied, the per-phase times (LocationIndex::UpdateTimes) and the wall
+// time of apply() are recorded in ns. The first warm-up ticks (allocations, cold caches) are not recorded.
+// The latencies are kept per path apply() took (UPDATE_AUTO switches between merge and resort), and a phase is only recorded
+// on the ticks it ran, so the percentiles of one path are not mixed with the zeros of the other.
+// report: p50 / p95 / p99 / max per path and phase, throughput in moves/s (moves / summed apply time)
+// run_compact: compact mode (LocationIndex::set_compact) against a non-compact twin, see there
+class SimulationDriverApp : public SortByLocTesterApp{
+    using time_unit_t = std::chrono::nanoseconds;
+public:
+    struct Latencies{
+        std::vector<long int> locPtrs;
+        std::vector<long int> agents;
+        std::vector<long int> locations;
+        std::vector<long int> resort;
+        std::vector<long int> positions;
+        std::vector<long int> apply;  // wall time of the whole apply(), with the parts outside the phases
+    };
+
+private:
+    int _tickN;
+    int _warmUpN = 20;
+    int _verifyEvery = 500;  // ticks between two verifications (not timed), 0 = never
+    double _changeRatio;
+    uint64_t _seed = 2020;
+
+    LocationIndex::UpdateAlg _updateAlg;
+    std::string _calibrationFile = "times/locChanges/update_calibration.txt";
+
+    std::vector<uint64_t> _taken;  // scratch of gen_loc_changes
+    Latencies _latencies[LocationIndex::UPDATE_AUTO];  // per path taken: UPDATE_COMPACTION, UPDATE_MERGE, UPDATE_RESORT
+    long int _moves = 0;
+    bool _verified = true;
+    bool _pointQueries = true;  // check_point_queries after every tick
+
+public:
+    SimulationDriverApp(int agentN, int tickN = 2000, double changeRatio = 0.01, LocationIndex::UpdateAlg updateAlg = LocationIndex::UPDATE_MERGE){
+        __agentN = agentN;
+        __locN = __agentN / 3;
+        _tickN = tickN;
+        _changeRatio = changeRatio;
+        _updateAlg = updateAlg;
+        timesFile.open("times/locChanges/DRIVER_times_"+to_str(__agentN)+"_"+to_str(_changeRatio)+"_"+alg_name(_updateAlg)+".txt");
+    }
+
+    void run(){
+        std::cout << "agentN: " << __agentN << "\tticks: " << _tickN << "\tchange ratio: " << _changeRatio
+                  << "\tupdate: " << alg_name(_updateAlg) << std::endl;
+        std::vector<int> agents(__agentN), locationOfAgent(__agentN);
+        init_vectors(agents, locationOfAgent, _seed);
+        int changeN = std::max(1, (int)(_changeRatio * __agentN));
+
+        LocationIndex index(locationOfAgent, __locN, _updateAlg);
+        if(_updateAlg == LocationIndex::UPDATE_AUTO)
+            index.calibrate(_calibrationFile);
+
+        for(int tick = 0; tick < _warmUpN + _tickN; tick++){
+            std::vector<LocChange> changes = gen_loc_changes(locationOfAgent, __locN, changeN, _seed, tick, _taken);
+            for(const LocChange& lch : changes)
+                locationOfAgent[lch.agent] = lch.to;
+
+            auto t_begin = std::chrono::high_resolution_clock::now();
+            LocationIndex::UpdateTimes times = index.apply(changes);
+            auto t_end = std::chrono::high_resolution_clock::now();
+
+            if(tick >= _warmUpN){
+                LocationIndex::UpdateAlg alg = index.last_update_alg();
+                Latencies& latencies = _latencies[alg];
+                if(alg == LocationIndex::UPDATE_RESORT)
+                    latencies.resort.push_back(times.resort);
+                else{
+                    latencies.agents.push_back(times.agents);
+                    latencies.locPtrs.push_back(times.locPtrs);
+                    if(alg == LocationIndex::UPDATE_COMPACTION && !index.compact())
+                        latencies.locations.push_back(times.locations);
+                }
+                latencies.positions.push_back(times.positions);
+                latencies.apply.push_back(std::chrono::duration_cast<time_unit_t>( t_end - t_begin ).count());
+                _moves += changes.size();
+            }
+            _pointQueries = _pointQueries && check_point_queries(index, tick);
+            if(_verifyEvery > 0 && (tick + 1) % _verifyEvery == 0)
+                _verified = _verified && index.verify(locationOfAgent).ok();
+        }
+        _verified = _verified && index.verify(locationOfAgent).ok();
+
+        report();
+    }
+
+    // every strategy for ticksPerAlg ticks on a compact index and on a non-compact twin with the same changes: location_at(i)
+    // of the compact one is checked against the twin's locations() for every slot after every tick. Reported per strategy:
+    // mean apply() time of both, and the bytes of both (LocationIndex::bytes(), the largest over the ticks)
+    bool run_compact(int ticksPerAlg = 50){
+        std::cout << "agentN: " << __agentN << "\tcompact mode vs non-compact, ticks per strategy: " << ticksPerAlg << std::endl;
+        std::vector<int> agents(__agentN), locationOfAgent(__agentN);
+        init_vectors(agents, locationOfAgent, _seed);
+        int changeN = std::max(1, (int)(_changeRatio * __agentN));
+
+        LocationIndex compact(locationOfAgent, __locN), twin(locationOfAgent, __locN);
+        compact.set_compact(true);
+        bool ok = true;
+        uint64_t tick = 0;
+        std::cout << "strategy\tcompact [ns]\tnon-compact [ns]\tcompact [B]\tnon-compact [B]\tsaved [B]" << std::endl;
+        for(LocationIndex::UpdateAlg alg : {LocationIndex::UPDATE_COMPACTION, LocationIndex::UPDATE_MERGE, LocationIndex::UPDATE_RESORT}){
+            compact.set_update_alg(alg);
+            twin.set_update_alg(alg);
+            long int compactTime = 0, twinTime = 0;
+            std::size_t compactBytes = 0, twinBytes = 0;
+            for(int k = 0; k < ticksPerAlg; k++){
+                std::vector<LocChange> changes = gen_loc_changes(locationOfAgent, __locN, changeN, _seed, tick++, _taken);
+                for(const LocChange& lch : changes)
+                    locationOfAgent[lch.agent] = lch.to;
+
+                compactTime += apply_time(compact, changes);
+                twinTime    += apply_time(twin, changes);
+                compactBytes = std::max(compactBytes, compact.bytes());
+                twinBytes    = std::max(twinBytes, twin.bytes());
+
+                long int badSlots = 0;
+                #pragma omp parallel for schedule(static) reduction(+:badSlots)
+                for(long int i = 0; i < __agentN; i++)
+                    badSlots += compact.location_at(i) != twin.locations()[i];
+                ok = ok && badSlots == 0 && compact.agents() == twin.agents() && compact.locPtrs() == twin.locPtrs()
+                        && compact.verify(locationOfAgent).ok() && check_point_queries(compact, tick) && check_point_queries(twin, tick);
+            }
+            std::cout << alg_name(alg) << "  \t" << compactTime / ticksPerAlg << "\t" << twinTime / ticksPerAlg << "\t" << compactBytes
+                      << "\t" << twinBytes << "\t" << (long int)twinBytes - (long int)compactBytes << std::endl;
+            std::string prefix = std::string("compact_") + alg_name(alg);
+            to_file(std::vector<long int>{compactTime / ticksPerAlg, twinTime / ticksPerAlg}, timesFile, prefix + "_apply_ns = ");
+            to_file(std::vector<long int>{(long int)compactBytes, (long int)twinBytes}, timesFile, prefix + "_bytes = ");
+        }
+        std::cout << "compact location_at: \t" << ok << std::endl;
+        return ok;
+    }
+
+    // latencies of the ticks that took the path alg (UPDATE_COMPACTION, UPDATE_MERGE or UPDATE_RESORT), empty if none did
+    const Latencies& latencies(LocationIndex::UpdateAlg alg) const{
+        return _latencies[alg];
+    }
+
+private:
+    static const char* alg_name(LocationIndex::UpdateAlg alg){
+        switch(alg){
+            case LocationIndex::UPDATE_COMPACTION: return "compaction";
+            case LocationIndex::UPDATE_MERGE:      return "merge";
+            case LocationIndex::UPDATE_RESORT:     return "resort";
+            default:                               return "auto";
+        }
+    }
+
+    // p50, p95, p99, max
+    // O(1) point queries on sampled agents: agents()[position_of(a)] == a and location_at(position_of(a)) == location_of(a)
+    bool check_point_queries(const LocationIndex& index, uint64_t tick, int sampleN = 256) const{
+        for(int s = 0; s < sampleN; s++){
+            int agent = counter_rng::uniform(_seed, tick, s, 3, __agentN);
+            long int i = index.position_of(agent);
+            if(i < 0 || i >= __agentN || index.agents()[i] != agent || index.location_at(i) != index.location_of(agent))
+                return false;
+        }
+        return true;
+    }
+
+    static long int apply_time(LocationIndex& index, sorting::span<const LocChange> changes){
+        auto t_begin = std::chrono::high_resolution_clock::now();
+        index.apply(changes);
+        auto t_end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration_cast<time_unit_t>( t_end - t_begin ).count();
+    }
+
+    static std::vector<long int> percentiles(const std::vector<long int>& times){
+        std::vector<long int> p;
+        for(double q : {50.0, 95.0, 99.0, 100.0})
+            p.push_back(percentile(times, q));
+        return p;
+    }
+
+    void report(){
+        long int applySum = 0;
+        for(const Latencies& latencies : _latencies)
+            for(long int t : latencies.apply)
+                applySum += t;
+        double movesPerSec = applySum > 0 ? _moves / (applySum * 1e-9) : 0;
+
+        std::cout << "verified: \t" << _verified << "\tpoint queries: " << _pointQueries << std::endl;
+        for(int alg = 0; alg < LocationIndex::UPDATE_AUTO; alg++){
+            const Latencies& latencies = _latencies[alg];
+            if(latencies.apply.empty())
+                continue;
+            std::string path = alg_name((LocationIndex::UpdateAlg)alg);
+            std::cout << path << " ticks: " << latencies.apply.size() << " / " << _tickN << std::endl;
+            std::cout << "phase [ns]\tp50\tp95\tp99\tmax" << std::endl;
+            const std::pair<const char*, const std::vector<long int>*> phases[] = {
+                {"locPtrs", &latencies.locPtrs}, {"agents", &latencies.agents}, {"locations", &latencies.locations},
+                {"resort", &latencies.resort}, {"positions", &latencies.positions}, {"apply", &latencies.apply}
+            };
+            for(const auto& phase : phases){
+                if(phase.second->empty())
+                    continue;
+                std::vector<long int> p = percentiles(*phase.second);
+                std::cout << phase.first << "  \t" << p[0] << "\t" << p[1] << "\t" << p[2] << "\t" << p[3] << std::endl;
+                to_file(p, timesFile, path + "_times_" + phase.first + "_ns = ");
+            }
+            to_file(std::vector<long int>{(long int)latencies.apply.size()}, timesFile, path + "_ticks = ");
+        }
+        std::cout << "throughput: \t" << movesPerSec << " moves/s" << std::endl;
+
+        to_file(std::vector<double>{50, 95, 99, 100}, timesFile, "percentiles = ");
+        to_file(std::vector<double>{movesPerSec}, timesFile, "moves_per_s = ");
+    }
+};
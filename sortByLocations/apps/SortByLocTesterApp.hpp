@@ -2,6 +2,7 @@
 
 #include "../include/printers.h"
 #include "../include/sorting.h"
+#include "../include/locchange.h"
 
 #include <iostream>
 #include <vector>
@@ -20,12 +21,10 @@ protected:
     int __agentN = 1<<20; //1<<26;     // 2^18 - fast, 2^20 ~= 1 million // number of values   (number of agents in the COVID simulator)  
     int __locN =  __agentN / 3;               // number of distinct locations (number of locations in the COVID simulator)
 
-    void init_vectors(std::vector<int>& agents, std::vector<int>& locations){
+    // agents: IDs in order, locations: uniform random, the same for the same seed (gen_locations)
+    void init_vectors(std::vector<int>& agents, std::vector<int>& locations, uint64_t seed = 2020){
         std::iota(agents.begin(), agents.end(), 0);
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<int> distrib(0, __locN-1);
-        std::generate(locations.begin(), locations.end(), [&](){ return distrib(gen); });
+        gen_locations(locations, __locN, seed);
     }
 
     static std::vector<int> genRange(){
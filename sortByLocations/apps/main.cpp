@@ -29,6 +29,8 @@
 
 #include "sortByLocationsApp.hpp"
 #include "LocChangeHandlingApp.hpp"
+#include "GappedIndexBenchmarkApp.hpp"
+#include "SimulationDriverApp.hpp"
 #include "../include/printers.h"
 
 #include <iomanip>
@@ -43,6 +45,7 @@ int main(void){
 #endif
     LocChangeHandlingApp app(10000);
     //SortByLocationsApp app;
+    //GappedIndexBenchmarkApp(1000000).run();   // CSR update vs gapped buckets vs sorting again, at different change ratios
     LocChangeHandlingApp::Times times;
     
     times = app.run();
@@ -55,7 +58,17 @@ int main(void){
     printer::to_file(times.times_refreshLocations, file, "times_refreshLocations = ");
     printer::to_file(fullUpdateTime, file, "\n\ntimes_fullUpdate = ");
     printer::to_file(times.times_sortAgain, file, "times_sortAgain = ");
+    printer::to_file(times.times_sortAgainPacked64, file, "times_sortAgainPacked64 = ");
+    printer::to_file(times.times_sortAgainAdaptive, file, "times_sortAgainAdaptive = ");
+    printer::to_file(times.times_refreshTwoLevel, file, "times_refreshTwoLevel = ");
+    printer::to_file(times.times_sortAgainTwoLevel, file, "times_sortAgainTwoLevel = ");
 
     file.close();
+
+    SimulationDriverApp driver(10000, 2000, 0.01);  // steady state over many ticks: p50/p95/p99/max per phase, moves/s
+    driver.run();
+    driver.run_compact();  // compact mode: location_at checked against a non-compact twin, apply time and bytes per strategy
+    SimulationDriverApp driverAuto(10000, 2000, 0.01, LocationIndex::UPDATE_AUTO);  // merge or resort per tick, calibrated
+    driverAuto.run();
     return 0;
 }  
@@ -46,6 +46,7 @@ using namespace printer;
 
 
 class SortByLocationsApp : public SortByLocTesterApp{
+    SortWorkspace _ws;  // reused by the sorts of every array size
 public:    
     SortByLocationsApp(){
         timesFile.open("times/GEN_times_2pow"+to_str(log2(__agentN))+".txt");
@@ -57,11 +58,11 @@ public:
 
 
     void run(){ 
-        std::cout<<"agentN: "<<__agentN<<std::endl;
+        std::cout<<"agentN: "<<__agentN<<"\tsorting network: "<<simdsort::network_name()<<std::endl;
         // Init
         std::vector<int> agents(__agentN);
         std::vector<int> locations(__agentN);
-        std::vector<int> locPtrs(__locN+1);
+        std::vector<int> locPtrs(__locN+1), locPtrs_scan(__locN+1), locPtrs_counting(__locN+1);
         init_vectors(agents, locations);
 
     /*
@@ -74,6 +75,13 @@ public:
         //For(arraysizes)
         std::cout<<"std PAIR ------------------------------------------\n";
         std::vector<float> times_sort(__range.size()), times_gen_locPtrs(__range.size()), sum(__range.size());
+        std::vector<float> times_sort_with_locPtrs(__range.size()), times_gen_locPtrs_scan(__range.size());
+        std::vector<float> times_sort_key_first(__range.size());
+        std::vector<float> times_sort_indices(__range.size()), times_sort_indices_inplace(__range.size());
+        std::vector<float> times_sort_radix(__range.size()), times_sort_packed64(__range.size()), times_sort_packed64_radix(__range.size());
+        std::vector<float> times_sort_paired_vector_it(__range.size()), times_sort_packed64_merge(__range.size());
+        std::vector<float> times_sort_by_key_seq(__range.size()), times_sort_by_key_par(__range.size());
+        std::vector<float> times_sort_by_key_narrow_seq(__range.size()), times_sort_by_key_narrow_par(__range.size());
         for(int i = 0; i<__range.size(); i++){
             std::cout<<i;
             int currSize = __range[i];
@@ -82,22 +90,85 @@ public:
             agents.resize(currSize);
             locations.resize(currSize);
             init_vectors(agents, locations);
+            std::vector<int> agents2 = agents;       // same input for the fused counting sort
+            std::vector<int> locations2 = locations;
+            const std::vector<int> agentsIn = agents, locationsIn = locations;  // ... and for the other sort_* paths
 
             for(int k = 0; k<1; k++){
                 
-                float time_sort = sort_STD_PAIR(agents, locations);
-                float time_gen_locPtrs = generateKeyPtrs(locations, locPtrs);
+                float time_sort = sort_STD_PAIR(agents, locations, _ws);
+                // sort_STD_PAIR orders the (value, key) pairs by value first: the reference of the sort_* paths and the
+                // input of both locPtrs variants is the 1. location 2. agent order of sort_MY_PAIR
+                agents = agentsIn;
+                locations = locationsIn;
+                times_sort_key_first[i] = sort_MY_PAIR(agents, locations, _ws);
+                float time_gen_locPtrs = generateKeyPtrs(locations, locPtrs, KEYPTRS_LOWER_BOUND);
+                times_gen_locPtrs_scan[i] = generateKeyPtrs(locations, locPtrs_scan, KEYPTRS_BOUNDARY_SCAN);
+                std::cout << "\tsorted: " << std::is_sorted(locations.begin(), locations.end())
+                          << "\teq_locPtrs_scan: " << (locPtrs == locPtrs_scan);
 
                 times_sort[i] = time_sort; // overwriting the fist measurement with the second, because teh first is invalid.
                 times_gen_locPtrs[i] = time_gen_locPtrs;
-                sum[i] = time_sort + time_gen_locPtrs;
+                sum[i] = times_sort_key_first[i] + time_gen_locPtrs;
+
+                // fused: the same (location, agent) order and the same locPtrs in one pass
+                times_sort_with_locPtrs[i] = sort_COUNTING_WITH_PTRS(agents2, locations2, locPtrs_counting, _ws);
+                std::cout << "\teq_counting: " << (agents2 == agents && locations2 == locations && locPtrs_counting == locPtrs);
+
+                // argsort + gather, and argsort + in-place cycle-following checked against the gather
+                std::vector<int> agentsGather = agentsIn, locationsGather = locationsIn;
+                times_sort_indices[i] = sort_HELPER_INDICES_VECTOR(agentsGather, locationsGather, _ws);
+                std::cout << "\teq_indices: " << (agentsGather == agents && locationsGather == locations);
+                times_sort_indices_inplace[i] = time_sort_copy("indices_inplace", [this](std::vector<int>& a, std::vector<int>& l){
+                    return sort_HELPER_INDICES_VECTOR(a, l, _ws, PERMUTE_INPLACE); }, agentsIn, locationsIn, agentsGather, locationsGather);
+
+                times_sort_radix[i] = time_sort_copy("radix", [this](std::vector<int>& a, std::vector<int>& l){ return sort_RADIX(a, l, _ws); },
+                                                     agentsIn, locationsIn, agents, locations);
+                times_sort_packed64[i] = time_sort_copy("packed64", [this](std::vector<int>& a, std::vector<int>& l){ return sort_PACKED64(a, l, _ws); },
+                                                        agentsIn, locationsIn, agents, locations);
+                times_sort_packed64_radix[i] = time_sort_copy("packed64_radix", [this](std::vector<int>& a, std::vector<int>& l){ return sort_PACKED64_RADIX(a, l, _ws); },
+                                                              agentsIn, locationsIn, agents, locations);
+                times_sort_paired_vector_it[i] = time_sort_copy("paired_vector_it", [](std::vector<int>& a, std::vector<int>& l){ return sort_PAIRED_VECTOR_ITERATOR(a, l); },
+                                                                agentsIn, locationsIn, agents, locations);
+                times_sort_packed64_merge[i] = time_sort_copy("packed64_merge", [this](std::vector<int>& a, std::vector<int>& l){ return sort_PACKED64_MERGE(a, l, _ws); },
+                                                              agentsIn, locationsIn, agents, locations);
+
+                // generic sort_by_key under seq and par: keys in [0, __locN), and narrow keys (16 bits, the radix passes
+                // move uint16_t copies) - the reference of the narrow ones is sort_RADIX on the same input
+                times_sort_by_key_seq[i] = time_sort_copy("by_key_seq", [this](std::vector<int>& a, std::vector<int>& l){
+                    return sort_by_key(std::execution::seq, span<int>(l), span<int>(a), __locN, _ws); }, agentsIn, locationsIn, agents, locations);
+                times_sort_by_key_par[i] = time_sort_copy("by_key_par", [this](std::vector<int>& a, std::vector<int>& l){
+                    return sort_by_key(std::execution::par, span<int>(l), span<int>(a), __locN, _ws); }, agentsIn, locationsIn, agents, locations);
+                std::vector<int> locationsNarrow(currSize);
+                std::transform(std::execution::par, locationsIn.begin(), locationsIn.end(), locationsNarrow.begin(), [](int loc){ return loc & 0xFFFF; });
+                std::vector<int> agentsNarrowRef = agentsIn, locationsNarrowRef = locationsNarrow;
+                sort_RADIX(agentsNarrowRef, locationsNarrowRef, _ws);
+                times_sort_by_key_narrow_seq[i] = time_sort_copy("by_key_narrow_seq", [this](std::vector<int>& a, std::vector<int>& l){
+                    return sort_by_key(std::execution::seq, span<int>(l), span<int>(a), 1 << 16, _ws); }, agentsIn, locationsNarrow, agentsNarrowRef, locationsNarrowRef);
+                times_sort_by_key_narrow_par[i] = time_sort_copy("by_key_narrow_par", [this](std::vector<int>& a, std::vector<int>& l){
+                    return sort_by_key(std::execution::par, span<int>(l), span<int>(a), 1 << 16, _ws); }, agentsIn, locationsNarrow, agentsNarrowRef, locationsNarrowRef);
+                std::cout << std::endl;
             }
 
         }
         to_file(__range, timesFile, "range = ");
         to_file(times_sort, timesFile, "times_sort = ");
+        to_file(times_sort_key_first, timesFile, "times_sort_key_first = ");
         to_file(times_gen_locPtrs, timesFile, "times_gen_locPtrs = ");
+        to_file(times_gen_locPtrs_scan, timesFile, "times_gen_locPtrs_scan = ");
         to_file(sum, timesFile, "sum = ");
+        to_file(times_sort_with_locPtrs, timesFile, "times_sort_with_locPtrs = ");
+        to_file(times_sort_indices, timesFile, "times_sort_indices = ");
+        to_file(times_sort_indices_inplace, timesFile, "times_sort_indices_inplace = ");
+        to_file(times_sort_radix, timesFile, "times_sort_radix = ");
+        to_file(times_sort_packed64, timesFile, "times_sort_packed64 = ");
+        to_file(times_sort_packed64_radix, timesFile, "times_sort_packed64_radix = ");
+        to_file(times_sort_paired_vector_it, timesFile, "times_sort_paired_vector_it = ");
+        to_file(times_sort_packed64_merge, timesFile, "times_sort_packed64_merge = ");
+        to_file(times_sort_by_key_seq, timesFile, "times_sort_by_key_seq = ");
+        to_file(times_sort_by_key_par, timesFile, "times_sort_by_key_par = ");
+        to_file(times_sort_by_key_narrow_seq, timesFile, "times_sort_by_key_narrow_seq = ");
+        to_file(times_sort_by_key_narrow_par, timesFile, "times_sort_by_key_narrow_par = ");
     /*
         std::cout<<"Sortd by locations\n";
         PRINT_vector(agents);
@@ -168,6 +239,16 @@ public:
 
     }
 
+    // sortFn on a copy of the input, eq: the same (location, agent) grouping as the reference
+    template<typename Sort>
+    float time_sort_copy(const char* name, Sort sortFn, const std::vector<int>& agentsIn, const std::vector<int>& locationsIn,
+                         const std::vector<int>& agentsRef, const std::vector<int>& locationsRef){
+        std::vector<int> agents = agentsIn, locations = locationsIn;
+        float time = sortFn(agents, locations);
+        std::cout << "\teq_" << name << ": " << (agents == agentsRef && locations == locationsRef);
+        return time;
+    }
+
     ~SortByLocationsApp(){
         timesFile.close();
     }
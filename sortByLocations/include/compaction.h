@@ -0,0 +1,50 @@
+#ifndef COMPACTION_H
+#define COMPACTION_H
+
+#ifndef GPU
+// for CPU:
+#include <pstl/algorithm>
+#include <pstl/numeric>
+#include <pstl/execution>
+#else
+// for GPU:
+#include <algorithm>
+#include <numeric>
+#include <execution>
+#endif
+
+#include <vector>
+
+// parallel stream compaction: keep flags -> exclusive scan (the new index of every kept element) -> parallel scatter
+namespace compaction{
+
+    // ranks[i] = number of kept elements before i (ranks must not alias keep), returns the number of kept elements
+    inline long int keep_ranks(const int* keep, int* ranks, long int N){
+        if(N == 0)
+            return 0;
+        std::exclusive_scan(std::execution::par, keep, keep + N, ranks, 0);
+        return ranks[N-1] + keep[N-1];
+    }
+
+    // scatter(i, rank) is called in parallel for every kept i, rank = its index in the compacted sequence
+    template<typename Scatter>
+    long int compact(const int* keep, int* ranks, long int N, Scatter scatter){
+        long int kept = keep_ranks(keep, ranks, N);
+        #pragma omp parallel for schedule(static)
+        for(long int i = 0; i < N; i++)
+            if(keep[i])
+                scatter(i, ranks[i]);
+        return kept;
+    }
+
+    // flags[i] = 1, except flags[drop[d]] = 0 for every index in drop
+    inline void keep_flags_except(int* flags, long int N, const int* drop, long int dropN){
+        std::fill(std::execution::par, flags, flags + N, 1);
+        #pragma omp parallel for schedule(static)
+        for(long int d = 0; d < dropN; d++)
+            flags[drop[d]] = 0;
+    }
+
+} // namespace compaction
+
+#endif //COMPACTION_H
@@ -0,0 +1,30 @@
+#ifndef COUNTER_RNG_H
+#define COUNTER_RNG_H
+
+#include <cstdint>
+
+// counter-based random numbers: the number is a pure function of (seed, tick, id, stream)
+//  - no generator state, so any element can be drawn independently in a parallel loop
+//  - the same seed gives the same workload on any thread count, in any run
+namespace counter_rng{
+
+    // splitmix64 finalizer
+    inline uint64_t mix(uint64_t x){
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    inline uint64_t random(uint64_t seed, uint64_t tick, uint64_t id, uint64_t stream = 0){
+        return mix(mix(mix(mix(seed) ^ tick) ^ id) ^ stream);
+    }
+
+    // uniform in [0, n) (multiply-shift, no modulo bias worth mentioning for n << 2^32)
+    inline uint32_t uniform(uint64_t seed, uint64_t tick, uint64_t id, uint64_t stream, uint32_t n){
+        return (uint32_t)(((random(seed, tick, id, stream) >> 32) * (uint64_t)n) >> 32);
+    }
+
+} // namespace counter_rng
+
+#endif //COUNTER_RNG_H
@@ -0,0 +1,193 @@
+#ifndef GAPPED_LOCATION_INDEX_H
+#define GAPPED_LOCATION_INDEX_H
+
+#ifndef GPU
+// for CPU:
+#include <pstl/algorithm>
+#include <pstl/numeric>
+#include <pstl/execution>
+#else
+// for GPU:
+#include <algorithm>
+#include <numeric>
+#include <execution>
+#endif
+
+#include <vector>
+#include <cstdint>
+
+#include "locchange.h"
+#include "sorting.h"
+#include "span.h"
+
+// agents grouped by location with spare slots in every bucket (packed memory array style)
+//  bucket l is _slots[_bucketPtrs[l], _bucketPtrs[l+1]), its first _counts[l] slots hold the agents (in no particular order)
+//  a move is O(1): the leaving agent's slot is filled by the last agent of its bucket, the arriving agent goes after the last
+//  one of the new bucket. A full bucket is rebalanced with its neighbours: the smallest aligned window of 2^k buckets around it
+//  whose density is under the threshold of its level gets its free slots spread evenly. If even the whole array is too
+//  dense, everything is rebuilt with more slack.
+// Agents never leave the index, so the array can't get too sparse: only the upper density threshold is maintained.
+class GappedLocationIndex{
+public:
+    constexpr static double SLACK = 0.25;             // free slots per agent after a (re)build
+    constexpr static double MAX_DENSITY_LEAF = 1.0;   // density thresholds of the rebalance windows:
+    constexpr static double MAX_DENSITY_ROOT = 0.85;  //  linear between the single bucket and the whole array
+
+private:
+    int _agentN = 0;
+    int _locN = 0;
+
+    std::vector<int> _slots;
+    std::vector<long int> _bucketPtrs;
+    std::vector<int> _counts;
+    std::vector<long int> _pos;            // agent -> slot
+    std::vector<int> _locationOfAgent;     // agent -> location
+
+    std::vector<int> _tmp;                 // agents of a window while rebalancing
+    long int _rebalances = 0;
+    long int _rebuilds = 0;
+
+public:
+    GappedLocationIndex(){}
+
+    GappedLocationIndex(sorting::span<const int> locationOfAgent, int locN){
+        build(locationOfAgent, locN);
+    }
+
+    void build(sorting::span<const int> locationOfAgent, int locN){
+        _agentN = locationOfAgent.size();
+        _locN = locN;
+        _locationOfAgent.assign(locationOfAgent.begin(), locationOfAgent.end());
+        _pos.resize(_agentN);
+        rebuild(SLACK);
+    }
+
+    // changes: every agent at most once, from = the current location of the agent (the order doesn't matter)
+    //  sequential: every move is O(1) amortized, the rebalances are local
+    void apply(sorting::span<const LocChange> changes){
+        for(const LocChange& lch : changes)
+            move(lch.agent, lch.to);
+    }
+
+    void move(int agent, int to){
+        int from = _locationOfAgent[agent];
+        // delete: the last agent of the bucket takes the slot
+        long int slot = _pos[agent];
+        long int last = _bucketPtrs[from] + (--_counts[from]);
+        int lastAgent = _slots[last];
+        _slots[slot] = lastAgent;
+        _pos[lastAgent] = slot;
+        // insert
+        _locationOfAgent[agent] = to;
+        if(_bucketPtrs[to] + _counts[to] == _bucketPtrs[to+1] && rebalance(to))
+            return;  // rebuilt: already in place
+        long int free = _bucketPtrs[to] + (_counts[to]++);
+        _slots[free] = agent;
+        _pos[agent] = free;
+    }
+
+    int agentN() const{ return _agentN; }
+    int locN() const{ return _locN; }
+    int location_of(int agent) const{ return _locationOfAgent[agent]; }
+    int count(int loc) const{ return _counts[loc]; }
+    const std::vector<int>& locationOfAgent() const{ return _locationOfAgent; }
+    sorting::span<const int> agents_at(int loc) const{
+        return sorting::span<const int>(_slots.data() + _bucketPtrs[loc], _counts[loc]);
+    }
+    long int capacity() const{ return _slots.size(); }
+    long int rebalances() const{ return _rebalances; }
+    long int rebuilds() const{ return _rebuilds; }
+
+    // CSR form (agents sorted by 1. location 2. agent), to compare with LocationIndex
+    void to_csr(std::vector<int>& agents, std::vector<int>& locations, std::vector<int>& locPtrs) const{
+        agents.resize(_agentN);
+        locations.resize(_agentN);
+        locPtrs.resize(_locN + 1);
+        std::exclusive_scan(std::execution::par, _counts.begin(), _counts.end(), locPtrs.begin(), 0);
+        locPtrs[_locN] = _agentN;
+        #pragma omp parallel for schedule(dynamic, 1024)
+        for(int loc = 0; loc < _locN; loc++){
+            sorting::span<const int> bucket = agents_at(loc);
+            std::copy(bucket.begin(), bucket.end(), agents.begin() + locPtrs[loc]);
+            std::sort(agents.begin() + locPtrs[loc], agents.begin() + locPtrs[loc+1]);
+            std::fill(locations.begin() + locPtrs[loc], locations.begin() + locPtrs[loc+1], loc);
+        }
+    }
+
+private:
+    // the free slots of the window [locBegin, locEnd) are spread evenly over its buckets, the remainder starting from bucket loc
+    void redistribute(int loc, int locBegin, int locEnd, long int slotBegin, long int slotEnd){
+        long int agentsInWindow = 0;
+        for(int l = locBegin; l < locEnd; l++)
+            agentsInWindow += _counts[l];
+        _tmp.resize(agentsInWindow);
+        long int k = 0;
+        for(int l = locBegin; l < locEnd; l++)
+            for(long int s = _bucketPtrs[l]; s < _bucketPtrs[l] + _counts[l]; s++)
+                _tmp[k++] = _slots[s];
+
+        long int gaps = (slotEnd - slotBegin) - agentsInWindow;
+        long int buckets = locEnd - locBegin;
+        long int slot = slotBegin;
+        k = 0;
+        for(int l = locBegin; l < locEnd; l++){
+            _bucketPtrs[l] = slot;
+            for(int a = 0; a < _counts[l]; a++){
+                _slots[slot] = _tmp[k++];
+                _pos[_slots[slot]] = slot;
+                slot++;
+            }
+            slot += gaps / buckets + ((l - loc + buckets) % buckets < gaps % buckets ? 1 : 0);
+        }
+    }
+
+    // makes room for one more agent in bucket loc, returns true if everything was rebuilt (the pending move included)
+    bool rebalance(int loc){
+        _rebalances++;
+        int levels = 0;
+        while((1L << levels) < _locN)
+            levels++;
+        for(int level = 1; level <= levels; level++){
+            long int width = 1L << level;
+            int locBegin = (int)((loc / width) * width);
+            int locEnd = (int)std::min<long int>(locBegin + width, _locN);
+            long int slotBegin = _bucketPtrs[locBegin];
+            long int slotEnd = _bucketPtrs[locEnd];
+            long int agentsInWindow = 1;  // + the arriving one
+            for(int l = locBegin; l < locEnd; l++)
+                agentsInWindow += _counts[l];
+            double maxDensity = MAX_DENSITY_LEAF - (MAX_DENSITY_LEAF - MAX_DENSITY_ROOT) * level / levels;
+            if(agentsInWindow <= maxDensity * (slotEnd - slotBegin)){
+                redistribute(loc, locBegin, locEnd, slotBegin, slotEnd);
+                return false;
+            }
+        }
+        _rebuilds++;
+        rebuild(SLACK);
+        return true;
+    }
+
+    // fresh layout from _locationOfAgent: bucket l gets counts[l] + slack * counts[l] + 1 slots
+    void rebuild(double slack){
+        _counts.assign(_locN, 0);
+        for(int loc : _locationOfAgent)
+            _counts[loc]++;
+        std::vector<long int> capacities(_locN + 1, 0);
+        std::transform(std::execution::par, _counts.begin(), _counts.end(), capacities.begin(), [slack](int count){
+            return (long int)(count * (1.0 + slack)) + 1;
+        });
+        _bucketPtrs.resize(_locN + 1);
+        std::exclusive_scan(std::execution::par, capacities.begin(), capacities.end(), _bucketPtrs.begin(), 0L);
+        _slots.assign(_bucketPtrs[_locN], -1);
+
+        // agents in ID order within the buckets: the fill cursor of every bucket
+        std::vector<long int> cursor(_bucketPtrs.begin(), _bucketPtrs.end() - 1);
+        for(int agent = 0; agent < _agentN; agent++){
+            long int slot = cursor[_locationOfAgent[agent]]++;
+            _slots[slot] = agent;
+            _pos[agent] = slot;
+        }
+    }
+};
+
+#endif //GAPPED_LOCATION_INDEX_H
@@ -0,0 +1,681 @@
+#ifndef LOCATION_INDEX_H
+#define LOCATION_INDEX_H
+
+#ifndef GPU
+// for CPU:
+#include <pstl/algorithm>
+#include <pstl/numeric>
+#include <pstl/execution>
+#else
+// for GPU:
+#include <algorithm>
+#include <numeric>
+#include <execution>
+#endif
+
+#include <vector>
+#include <chrono>
+#include <utility>
+#include <string>
+#include <fstream>
+
+#include "locchange.h"
+#include "sorting.h"
+#include "compaction.h"
+#include "workspace.h"
+#include "span.h"
+#include "merge.h"
+#include "counterrng.h"
+
+// agents grouped by location, kept up to date tick by tick
+//  agents()    - agent IDs sorted by 1. location 2. agent ID
+//  locations() - the location of agents()[i]
+//  locPtrs()   - the agents of location l are agents()[locPtrs()[l], locPtrs()[l+1])
+//  position_of(agent) - the index of the agent in agents() (inverse permutation, kept up to date by every strategy)
+//  agent IDs are 0 .. agentN-1, location IDs are 0 .. locN-1
+// apply() updates the grouping in place with one batch of location changes. The helper arrays of the update live in the
+// index, so a long-lived index doesn't allocate after the first tick.
+//  UPDATE_COMPACTION: the static agents are compacted, the movers' new slots are found with binary searches in them, the
+//                     static agents fill the remaining slots, _locations is refilled from _locPtrs afterwards
+//  UPDATE_MERGE:      the static agents are compacted as (location, agent) keys, the movers are sorted by (to, agent), and the
+//                     two sorted streams are merged with merge path, writing _agents and _locations in the same pass
+//  UPDATE_RESORT:     everything is sorted again from the agent -> location array (counting sort)
+//  UPDATE_AUTO:       UPDATE_MERGE or UPDATE_RESORT per tick, by the change ratio C/N against the crossover ratio of this
+//                     agent count, location count and thread count (calibrate())
+// Double buffered mode (set_double_buffered): every phase reads the current generation and writes a back buffer, the buffers
+// are swapped at the end of apply(). No phase writes what another one reads (the element-wise passes run par_unseq), and
+// the accessors keep showing the old generation until the swap (the swap itself has to be ordered with the readers by the
+// caller). After the swap the back buffers hold the generation before: apply() brings them up to date only where the last
+// apply() wrote (its movers, the offsets and the slots of its touched locations), agents are rewritten by every phase anyway.
+// Compact mode (set_compact): locations() is not kept, it is the same information as locPtrs() expanded to N ints. The
+// location of the ith agent of agents() is looked up with location_at(i): an Eytzinger (BFS) laid out copy of every
+// LOOKUP_BLOCK-th offset is searched first (small, the top levels stay in cache), then one block of locPtrs.
+// What stays N-sized in compact mode: agents, locationOfAgent and positions, plus the scratch of the incremental updates
+// (keep flags and ranks, and the static agents as (location, agent) pairs or packed 64 bit keys), kept in the index between
+// the ticks - workspace_bytes(). UPDATE_RESORT needs no N-sized scratch, only threads * locN ints of histograms.
+class LocationIndex{
+public:
+    using time_unit_t = std::chrono::nanoseconds;  // UpdateTimes: a small batch takes microseconds
+
+    enum UpdateAlg { UPDATE_COMPACTION, UPDATE_MERGE, UPDATE_RESORT, UPDATE_AUTO };
+
+    constexpr static double DEFAULT_CROSSOVER = 0.3;  // C/N above which UPDATE_AUTO re-sorts, until calibrate() is called
+    const static int LOOKUP_BLOCK = 16;               // locPtrs entries per sample of the location lookup
+    const static int CALIBRATION_REPS = 9;            // apply() calls per change ratio and strategy in calibrate()
+    const static int POS_RESCATTER_MAX_RATIO = 4;     // double buffered: positions are re-scattered below N / 4 touched slots, else copied
+
+    struct UpdateTimes{
+        long int locPtrs = 0;
+        long int agents = 0;
+        long int locations = 0;
+        long int resort = 0;
+        long int positions = 0;
+        long int full() const{ return locPtrs + agents + locations + resort + positions; }
+    };
+
+    struct Verification{
+        bool locPtrs = false;      // 0 = locPtrs[0] <= ... <= locPtrs[locN] = N
+        bool segments = false;     // every location's agents are sorted by ID (and locations() matches the segments)
+        bool permutation = false;  // agents() is a permutation of the IDs, positions are its inverse
+        bool contents = false;     // the (agent, location) pairs are the expected ones (order-independent hash)
+        bool ok() const{ return locPtrs && segments && permutation && contents; }
+    };
+
+private:
+    int _agentN = 0;
+    int _locN = 0;
+    UpdateAlg _updateAlg = UPDATE_COMPACTION;
+    UpdateAlg _lastAlg = UPDATE_COMPACTION;  // what the last apply() did (UPDATE_AUTO resolved)
+    double _crossover = DEFAULT_CROSSOVER;
+    bool _doubleBuffered = false;
+    bool _compact = false;
+
+    std::vector<int> _locationOfAgent;  // agent -> location  (sorted by agents)
+    std::vector<int> _agents;
+    std::vector<int> _locations;
+    std::vector<int> _locPtrs;
+    std::vector<int> _pos;              // agent -> index in _agents
+
+    // next generation in double buffered mode
+    std::vector<int> _locationOfAgentBack;
+    std::vector<int> _agentsBack;
+    std::vector<int> _locationsBack;
+    std::vector<int> _locPtrsBack;
+    std::vector<int> _posBack;
+    bool _backStale = true;                        // the back buffers have to be copied in full (first tick, mode change)
+    std::vector<std::pair<int,int>> _lastMoves;    // (agent, to) of the last apply()
+    long int _lastSlotsBegin = 0;                  // slots of the locations the last apply() touched
+    long int _lastSlotsEnd = 0;
+    int _lastPtrsBegin = 0;                        // locPtrs entries the last apply() wrote
+    int _lastPtrsEnd = 0;
+
+    // location lookup of the compact mode, rebuilt at the end of every update (O(locN / LOOKUP_BLOCK))
+    std::vector<int> _lookupSamples;  // locPtrs[j * LOOKUP_BLOCK], Eytzinger order, 1-based
+    std::vector<int> _lookupBlocks;   // j of _lookupSamples[k]
+
+    sorting::SortWorkspace _sortWs;
+    Workspace<int, uint64_t, std::pair<int,int>> _ws;  // helper arrays of apply(), kept between the ticks
+
+public:
+    LocationIndex(){}
+
+    // locationOfAgent[agent] = location of the agent
+    LocationIndex(sorting::span<const int> locationOfAgent, int locN, UpdateAlg updateAlg = UPDATE_COMPACTION) : _updateAlg(updateAlg){
+        build(locationOfAgent, locN);
+    }
+
+    void build(sorting::span<const int> locationOfAgent, int locN){
+        _agentN = locationOfAgent.size();
+        _locN = locN;
+        _locationOfAgent.assign(locationOfAgent.begin(), locationOfAgent.end());
+        _agents.resize(_agentN);
+        _locations.resize(_compact ? 0 : _agentN);
+        _locPtrs.resize(_locN + 1);
+        _pos.resize(_agentN);
+        resort(_locationOfAgent, _agents, _locations, _locPtrs);
+        scatter_positions(_agents, _pos, 0, _agentN);
+        if(_compact)
+            build_lookup();
+        _backStale = true;
+    }
+
+    // changes: every agent at most once, from = the current location of the agent, from != to,
+    //          sorted by 1. to 2. agent (sort_changes) - UPDATE_MERGE sorts the movers itself, any order will do
+    UpdateTimes apply(sorting::span<const LocChange> changes){
+        UpdateTimes times;
+        UpdateAlg alg = _updateAlg;
+        if(alg == UPDATE_AUTO)
+            alg = changes.size() > _crossover * _agentN ? UPDATE_RESORT : UPDATE_MERGE;
+        _lastAlg = alg;
+
+        if(_doubleBuffered)
+            sync_back_buffers();
+        // double buffered: the phases write the back buffers, single buffered: the output is the current generation
+        std::vector<int>& locationOfAgentOut = _doubleBuffered ? _locationOfAgentBack : _locationOfAgent;
+        std::vector<int>& agentsOut          = _doubleBuffered ? _agentsBack : _agents;
+        std::vector<int>& locationsOut       = _doubleBuffered ? _locationsBack : _locations;
+        std::vector<int>& locPtrsOut         = _doubleBuffered ? _locPtrsBack : _locPtrs;
+        std::vector<int>& posOut             = _doubleBuffered ? _posBack : _pos;
+
+        // agent -> location first: none of the update phases reads it
+        std::for_each(std::execution::par_unseq, changes.begin(), changes.end(), [&](const LocChange& lch){
+            locationOfAgentOut[lch.agent] = lch.to;
+        });
+
+        // only the slots of the locations between the lowest and the highest touched one can change
+        std::pair<int,int> touched = touched_locations(changes);
+        if(alg == UPDATE_RESORT){
+            times.resort = resort(locationOfAgentOut, agentsOut, locationsOut, locPtrsOut);
+            touched = std::make_pair(0, _locN - 1);
+        }
+        else if(alg == UPDATE_MERGE){
+            times.agents    = update_agents_MERGE(changes, agentsOut, locationsOut);
+            times.locPtrs   = update_locPtrs(changes, touched, locPtrsOut);
+        }
+        else{
+            times.agents    = update_agents(changes, agentsOut);
+            times.locPtrs   = update_locPtrs(changes, touched, locPtrsOut);
+            if(!_compact)
+                times.locations = update_locations(touched, locPtrsOut, locationsOut);
+        }
+        long int slotsBegin = 0, slotsEnd = 0;
+        if(touched.first <= touched.second){
+            slotsBegin = locPtrsOut[touched.first];
+            slotsEnd = locPtrsOut[touched.second + 1];
+            times.positions = scatter_positions(agentsOut, posOut, slotsBegin, slotsEnd);
+        }
+
+        if(_doubleBuffered){
+            // what the next apply() has to bring up to date in the buffers that become the back ones
+            _lastMoves.resize(changes.size());
+            std::transform(std::execution::par_unseq, changes.begin(), changes.end(), _lastMoves.begin(), [](const LocChange& lch){
+                return std::make_pair(lch.agent, lch.to);
+            });
+            _lastSlotsBegin = slotsBegin;
+            _lastSlotsEnd = slotsEnd;
+            _lastPtrsBegin = touched.first <= touched.second ? touched.first : 0;
+            _lastPtrsEnd = touched.first <= touched.second ? touched.second + 2 : 0;
+            _locationOfAgent.swap(_locationOfAgentBack);
+            _agents.swap(_agentsBack);
+            _locations.swap(_locationsBack);
+            _locPtrs.swap(_locPtrsBack);
+            _pos.swap(_posBack);
+        }
+        if(_compact)
+            build_lookup();
+        return times;
+    }
+
+    static void sort_changes(std::vector<LocChange>& changes){
+        sort_loc_changes(changes);
+    }
+
+    void set_update_alg(UpdateAlg updateAlg){ _updateAlg = updateAlg; }
+    UpdateAlg update_alg() const{ return _updateAlg; }
+    UpdateAlg last_update_alg() const{ return _lastAlg; }
+    void set_double_buffered(bool doubleBuffered){
+        _backStale = _backStale || doubleBuffered != _doubleBuffered;
+        _doubleBuffered = doubleBuffered;
+    }
+    bool double_buffered() const{ return _doubleBuffered; }
+
+    void set_compact(bool compact){
+        _compact = compact;
+        if(_compact){
+            std::vector<int>().swap(_locations);
+            std::vector<int>().swap(_locationsBack);
+            if(!_locPtrs.empty())  // else build() does it
+                build_lookup();
+        }
+        else if((long int)_locations.size() != _agentN){
+            _locations.resize(_agentN);
+            sorting::expandKeyPtrs(_locPtrs, _locations);
+            _backStale = true;
+        }
+    }
+    bool compact() const{ return _compact; }
+
+    // location of agents()[i], in both modes
+    int location_at(long int i) const{
+        if(!_compact)
+            return _locations[i];
+        // last sample <= i: branchless descent, then the first right turn from the bottom gives the first sample > i
+        long int n = _lookupSamples.size() - 1;
+        long int k = 1;
+        while(k <= n)
+            k = 2*k + (_lookupSamples[k] <= i);
+        k >>= __builtin_ffsl(~k);
+        long int block = (k == 0 ? (long int)n : _lookupBlocks[k]) - 1;
+        // last location in the block that starts at or before i
+        auto first = _locPtrs.begin() + block * LOOKUP_BLOCK;
+        auto last  = _locPtrs.begin() + std::min<long int>((block + 1) * LOOKUP_BLOCK, _locN + 1);
+        return std::distance(_locPtrs.begin(), std::upper_bound(first, last, (int)i)) - 1;
+    }
+    double crossover() const{ return _crossover; }
+
+    // crossover ratio of UPDATE_AUTO for the current agent count, location count and thread count:
+    //  read from the calibration file ("threads agentN locN crossover" lines), or measured and appended to it.
+    //  Lines with a crossover <= 0 are ignored. The ends are not written: without a usable measurement (-1) the ratio
+    //  stays, with the merge faster at every measured ratio (1) it is used in this run only.
+    double calibrate(const std::string& calibrationFile){
+        int threads = sorting::max_threads();
+        std::ifstream in(calibrationFile);
+        int t;
+        long int agentN, locN;
+        double crossover;
+        while(in >> t >> agentN >> locN >> crossover){
+            if(t == threads && agentN == _agentN && locN == _locN && crossover > 0){
+                _crossover = crossover;
+                return _crossover;
+            }
+        }
+        in.close();
+
+        double measured = measure_crossover();
+        if(measured < 0)
+            return _crossover;
+        _crossover = measured;
+        if(measured >= 1.0)
+            return _crossover;
+        std::ofstream out(calibrationFile, std::ios::app);
+        out << threads << " " << _agentN << " " << _locN << " " << _crossover << "\n";
+        return _crossover;
+    }
+
+    int agentN() const{ return _agentN; }
+    int locN() const{ return _locN; }
+    const std::vector<int>& agents() const{ return _agents; }
+    const std::vector<int>& locations() const{ return _locations; }  // empty in compact mode
+    const std::vector<int>& locPtrs() const{ return _locPtrs; }
+    const std::vector<int>& locationOfAgent() const{ return _locationOfAgent; }
+
+    int location_of(int agent) const{ return _locationOfAgent[agent]; }
+    int position_of(int agent) const{ return _pos[agent]; }
+    sorting::span<const int> agents_at(int loc) const{
+        return sorting::span<const int>(_agents.data() + _locPtrs[loc], _locPtrs[loc+1] - _locPtrs[loc]);
+    }
+
+    // parallel O(N) check of the index against the expected agent -> location array, without copies or re-sorting
+    Verification verify(sorting::span<const int> expectedLocationOfAgent) const{
+        Verification v;
+        long int N = _agentN;
+        int L = _locN;
+        v.locPtrs = _locPtrs.size() == (std::size_t)L + 1 && _locPtrs[0] == 0 && _locPtrs[L] == N
+                 && std::is_sorted(std::execution::par, _locPtrs.begin(), _locPtrs.end());
+        if(!v.locPtrs || (long int)expectedLocationOfAgent.size() != N)
+            return v;
+
+        // segments (+ locations and the hash of the pairs, in the same pass)
+        bool checkLocations = !_compact;
+        long int badSegments = 0;
+        uint64_t hash = 0;
+        #pragma omp parallel for schedule(dynamic, 1024) reduction(+:badSegments, hash)
+        for(int loc = 0; loc < L; loc++){
+            for(long int i = _locPtrs[loc]; i < _locPtrs[loc+1]; i++){
+                int agent = _agents[i];
+                if((i > _locPtrs[loc] && _agents[i-1] >= agent) || (checkLocations && _locations[i] != loc))
+                    badSegments++;
+                hash += counter_rng::mix(sorting::pack_key_value(loc, agent));
+            }
+        }
+        v.segments = badSegments == 0;
+
+        // pos[agents[i]] == i for every i: agents is injective, so a permutation
+        long int badPositions = 0;
+        #pragma omp parallel for schedule(static) reduction(+:badPositions)
+        for(long int i = 0; i < N; i++){
+            int agent = _agents[i];
+            if(agent < 0 || agent >= N || _pos[agent] != i)
+                badPositions++;
+        }
+        v.permutation = badPositions == 0;
+
+        uint64_t expectedHash = 0;
+        #pragma omp parallel for schedule(static) reduction(+:expectedHash)
+        for(long int agent = 0; agent < N; agent++)
+            expectedHash += counter_rng::mix(sorting::pack_key_value(expectedLocationOfAgent[agent], agent));
+        v.contents = hash == expectedHash;
+        return v;
+    }
+
+    std::size_t workspace_bytes() const{
+        return _ws.bytes() + _sortWs.bytes()
+             + (_locationOfAgentBack.capacity() + _agentsBack.capacity() + _locationsBack.capacity() + _locPtrsBack.capacity()
+              + _posBack.capacity() + _lookupSamples.capacity() + _lookupBlocks.capacity()) * sizeof(int)
+             + _lastMoves.capacity() * sizeof(std::pair<int,int>);
+    }
+
+    // everything the index holds: the current generation + workspace_bytes()
+    std::size_t bytes() const{
+        return (_locationOfAgent.capacity() + _agents.capacity() + _locations.capacity() + _locPtrs.capacity() + _pos.capacity()) * sizeof(int)
+             + workspace_bytes();
+    }
+
+private:
+    // agents, locations, locPtrs from locationOfAgent: counting sort of the agent IDs + locPtrs in one go, locations is
+    // locPtrs expanded (not in compact mode) - no N-sized scratch
+    long int resort(const std::vector<int>& locationOfAgent, std::vector<int>& agents, std::vector<int>& locationsOut, std::vector<int>& locPtrs){
+        auto t_begin = std::chrono::high_resolution_clock::now();
+        sorting::sort_COUNTING_IDS_WITH_PTRS(locationOfAgent, agents, locPtrs, _sortWs);
+        if(!_compact)
+            sorting::expandKeyPtrs(locPtrs, locationsOut);
+        auto t_end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration_cast<time_unit_t>( t_end - t_begin ).count();
+    }
+
+    // micro-benchmark on a copy of the index: apply() time with UPDATE_MERGE and with UPDATE_RESORT at a few change ratios
+    // (median of CALIBRATION_REPS ticks, the two strategies alternating so that they see the same noise). Both sides are
+    // whole apply() calls, so both pay the agent -> location and the position scatters. The crossover is interpolated
+    // after the last ratio where the merge is still faster; if it is faster everywhere, the two fitted lines (least
+    // squares) are extrapolated (1: merge everywhere).
+    //  -1: the merge is slower at every ratio - no usable measurement
+    double measure_crossover(){
+        using us = std::chrono::duration<double, std::micro>;
+        const double ratios[] = {0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.2, 0.4};
+        const int R = sizeof(ratios) / sizeof(ratios[0]);
+        LocationIndex probe(_locationOfAgent, _locN, UPDATE_MERGE);
+        probe.set_compact(_compact);
+        std::vector<uint64_t>& scratch = _ws.buffer<uint64_t>(2, 0);  // sized by gen_loc_changes
+        uint64_t tick = 0;
+
+        auto apply_time = [&](UpdateAlg alg, int changeN){
+            probe.set_update_alg(alg);
+            std::vector<LocChange> changes = gen_loc_changes(probe.locationOfAgent(), _locN, changeN, 0xCA1B, tick++, scratch);
+            auto t_begin = std::chrono::high_resolution_clock::now();
+            probe.apply(changes);
+            auto t_end = std::chrono::high_resolution_clock::now();
+            return std::chrono::duration_cast<us>( t_end - t_begin ).count();
+        };
+        auto median = [](std::vector<double>& times){
+            std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+            return times[times.size() / 2];
+        };
+
+        int maxChangeN = std::max(1, (int)(ratios[R-1] * _agentN));
+        apply_time(UPDATE_MERGE, maxChangeN);   // warm-up: workspace allocations of both paths
+        apply_time(UPDATE_RESORT, maxChangeN);
+
+        double mergeTimes[R], resortTimes[R];
+        std::vector<double> merge(CALIBRATION_REPS), resort(CALIBRATION_REPS);
+        int lastFaster = -1;  // last ratio where the merge is faster
+        for(int r = 0; r < R; r++){
+            int changeN = std::max(1, (int)(ratios[r] * _agentN));
+            for(int k = 0; k < CALIBRATION_REPS; k++){
+                merge[k]  = apply_time(UPDATE_MERGE, changeN);
+                resort[k] = apply_time(UPDATE_RESORT, changeN);
+            }
+            mergeTimes[r]  = median(merge);
+            resortTimes[r] = median(resort);
+            if(mergeTimes[r] < resortTimes[r])
+                lastFaster = r;
+        }
+
+        if(lastFaster < 0)
+            return -1;
+        if(lastFaster < R-1){
+            double d0 = mergeTimes[lastFaster] - resortTimes[lastFaster];            // < 0
+            double d1 = mergeTimes[lastFaster + 1] - resortTimes[lastFaster + 1];    // >= 0
+            return ratios[lastFaster] + (ratios[lastFaster + 1] - ratios[lastFaster]) * -d0 / (d1 - d0);
+        }
+        double mergeSlope, mergeIntercept, resortSlope, resortIntercept;
+        fit_line(ratios, mergeTimes, R, mergeSlope, mergeIntercept);
+        fit_line(ratios, resortTimes, R, resortSlope, resortIntercept);
+        if(mergeSlope <= resortSlope)
+            return 1.0;  // the lines don't meet
+        return std::min(1.0, std::max(ratios[R-1], (resortIntercept - mergeIntercept) / (mergeSlope - resortSlope)));
+    }
+
+    // least squares line through (x[i], y[i])
+    static void fit_line(const double* x, const double* y, int n, double& slope, double& intercept){
+        double meanX = 0, meanY = 0;
+        for(int i = 0; i < n; i++){
+            meanX += x[i] / n;
+            meanY += y[i] / n;
+        }
+        double cov = 0, var = 0;
+        for(int i = 0; i < n; i++){
+            cov += (x[i] - meanX) * (y[i] - meanY);
+            var += (x[i] - meanX) * (x[i] - meanX);
+        }
+        slope = cov / var;
+        intercept = meanY - slope * meanX;
+    }
+
+    // back buffers = current generation, except agents (every strategy rewrites them): in full after a mode change, else only
+    // the last apply()'s movers (agent -> location), the offsets of its touched locations (locPtrs) and their slots
+    // (positions, locations)
+    void sync_back_buffers(){
+        _locationOfAgentBack.resize(_agentN);
+        _agentsBack.resize(_agentN);
+        _locationsBack.resize(_compact ? 0 : _agentN);
+        _locPtrsBack.resize(_locN + 1);
+        _posBack.resize(_agentN);
+        if(_backStale){
+            std::copy(std::execution::par_unseq, _locationOfAgent.begin(), _locationOfAgent.end(), _locationOfAgentBack.begin());
+            std::copy(std::execution::par_unseq, _pos.begin(), _pos.end(), _posBack.begin());
+            std::copy(std::execution::par_unseq, _locPtrs.begin(), _locPtrs.end(), _locPtrsBack.begin());
+            if(!_compact)
+                std::copy(std::execution::par_unseq, _locations.begin(), _locations.end(), _locationsBack.begin());
+            _backStale = false;
+            return;
+        }
+        std::for_each(std::execution::par_unseq, _lastMoves.begin(), _lastMoves.end(), [&](std::pair<int,int> move){
+            _locationOfAgentBack[move.first] = move.second;
+        });
+        std::copy(std::execution::par_unseq, _locPtrs.begin() + _lastPtrsBegin, _locPtrs.begin() + _lastPtrsEnd, _locPtrsBack.begin() + _lastPtrsBegin);
+        // positions: the agents of the last touched slots - the random scatter pays off only for a small part of the slots
+        if((_lastSlotsEnd - _lastSlotsBegin) * POS_RESCATTER_MAX_RATIO < _agentN)
+            scatter_positions(_agents, _posBack, _lastSlotsBegin, _lastSlotsEnd);
+        else
+            std::copy(std::execution::par_unseq, _pos.begin(), _pos.end(), _posBack.begin());
+        if(!_compact)
+            std::copy(std::execution::par_unseq, _locations.begin() + _lastSlotsBegin, _locations.begin() + _lastSlotsEnd,
+                      _locationsBack.begin() + _lastSlotsBegin);
+    }
+
+    // Eytzinger layout of the samples: in-order walk of the implicit tree (children of k: 2k, 2k+1)
+    void build_lookup(){
+        long int sampleN = _locN / LOOKUP_BLOCK + 1;
+        _lookupSamples.resize(sampleN + 1);
+        _lookupBlocks.resize(sampleN + 1);
+        long int j = 0;
+        build_lookup(1, j, sampleN);
+    }
+    void build_lookup(long int k, long int& j, long int sampleN){
+        if(k > sampleN)
+            return;
+        build_lookup(2*k, j, sampleN);
+        _lookupSamples[k] = _locPtrs[j * LOOKUP_BLOCK];
+        _lookupBlocks[k] = j++;
+        build_lookup(2*k + 1, j, sampleN);
+    }
+
+    // pos[agents[i]] = i for i in [begin, end)
+    long int scatter_positions(const std::vector<int>& agents, std::vector<int>& pos, long int begin, long int end){
+        auto t_begin = std::chrono::high_resolution_clock::now();
+        #pragma omp parallel for simd schedule(static)
+        for(long int i = begin; i < end; i++)
+            pos[agents[i]] = i;
+        auto t_end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration_cast<time_unit_t>( t_end - t_begin ).count();
+    }
+
+    // lowest and highest location that is left or entered, (locN, -1) if there are no changes
+    std::pair<int,int> touched_locations(sorting::span<const LocChange> changes){
+        return std::transform_reduce(std::execution::par_unseq, changes.begin(), changes.end(), std::make_pair(_locN, -1),
+            [](std::pair<int,int> a, std::pair<int,int> b){ return std::make_pair(std::min(a.first, b.first), std::max(a.second, b.second)); },
+            [](const LocChange& lch){ return std::make_pair(std::min(lch.from, lch.to), std::max(lch.from, lch.to)); });
+    }
+
+    // per-thread histograms: contribute(h, change) adds the change to the bins h[0, binN), counts = the sum over the threads
+    template<typename Contribute>
+    void histogram(sorting::span<const LocChange> changes, std::vector<int>& counts, long int binN, int binsSlot, Contribute contribute){
+        int T = sorting::max_threads();
+        long int changeN = changes.size();
+        std::vector<int>& bins = _ws.buffer<int>(binsSlot, T * binN);
+        #pragma omp parallel num_threads(T)
+        {
+            int t = sorting::thread_num();
+            int nt = sorting::num_threads();
+            int* h = &bins[t * binN];
+            std::fill(h, h + binN, 0);
+            #pragma omp for schedule(static)
+            for(long int c = 0; c < changeN; c++)
+                contribute(h, changes[c]);
+            #pragma omp for schedule(static)
+            for(long int loc = 0; loc < binN; loc++){
+                int sum = 0;
+                for(int tt = 0; tt < nt; tt++)
+                    sum += bins[tt * binN + loc];
+                counts[loc] = sum;
+            }
+        }
+    }
+
+    // only the offsets of the touched locations change, [touched.first, touched.second + 1] - with a narrow touched range (e.g. the
+    // state-only changes of a TwoLevelIndex) the histograms and the scan don't cover all locN + 1 offsets
+    long int update_locPtrs(sorting::span<const LocChange> changes, std::pair<int,int> touched, std::vector<int>& locPtrsOut){
+        auto t_locPtrs_begin = std::chrono::high_resolution_clock::now();
+        if(touched.first <= touched.second){
+            // locPtrs[i] += #(to < i) - #(from < i)  =  exclusive scan of the delta histogram (+1 at to, -1 at from) from touched.first
+            int begin = touched.first;
+            long int binN = touched.second - begin + 2;
+            std::vector<int>& delta = _ws.buffer<int>(4, binN);
+            std::vector<int>& shift = _ws.buffer<int>(5, binN);   // not in place: the parallel in-place exclusive_scan is broken in the GCC pstl
+
+            histogram(changes, delta, binN, 3, [begin](int* h, const LocChange& lch){
+                h[lch.to - begin]++;
+                h[lch.from - begin]--;
+            });
+            std::exclusive_scan(std::execution::par, delta.begin(), delta.end(), shift.begin(), 0);
+            std::transform(std::execution::par_unseq, _locPtrs.begin() + begin, _locPtrs.begin() + begin + binN, shift.begin(),
+                           locPtrsOut.begin() + begin, std::plus<int>());
+        }
+        auto t_locPtrs_end = std::chrono::high_resolution_clock::now();
+
+        return std::chrono::duration_cast<time_unit_t>( t_locPtrs_end - t_locPtrs_begin ).count();
+    }
+
+    // reads _agents, _pos, _locPtrs, writes agentsOut (may be _agents: it is written only after the last read)
+    long int update_agents(sorting::span<const LocChange> changes, std::vector<int>& agentsOut){
+        long int changeN = changes.size();
+        long int staticN = _agentN - changeN;
+
+        // HELPER arrays  (from the workspace - no allocation after the first tick)
+        std::vector<std::pair<int,int>>& staticAgents_inds   = _ws.buffer<std::pair<int,int>>(0, staticN);
+        std::vector<std::pair<int,int>>& movingAgents_toInds = _ws.buffer<std::pair<int,int>>(1, changeN);
+
+        std::vector<int>& movingAgents_fromSlots = _ws.buffer<int>(0, changeN);
+        std::vector<int>& locPtrs_stat           = _ws.buffer<int>(1, _locN + 1);
+        std::vector<int>& movedOut               = _ws.buffer<int>(2, _locN + 1);
+        std::vector<int>& locPtrs_shifts         = _ws.buffer<int>(8, _locN + 1);
+        std::vector<int>& keepFlags              = _ws.buffer<int>(6, _agentN);  // compaction flags - deletion, then insertion
+        std::vector<int>& keepRanks              = _ws.buffer<int>(7, _agentN);
+
+        // ----------------------- START time measuring -------------------------------------
+        auto t_agents_begin = std::chrono::high_resolution_clock::now();
+
+        // slots of the moving agents
+        std::transform(std::execution::par_unseq, changes.begin(), changes.end(), movingAgents_fromSlots.begin(), [&](const LocChange& lch){
+            return _pos[lch.agent];
+        });
+
+        // (DELETION) staticAgents_inds = _agents - "moving Agents": stream compaction over the vacated slots
+        compaction::keep_flags_except(keepFlags.data(), _agentN, movingAgents_fromSlots.data(), changeN);
+        compaction::compact(keepFlags.data(), keepRanks.data(), _agentN, [&](long int oldInd, int newInd){
+            staticAgents_inds[newInd] = std::make_pair(_agents[oldInd], newInd);
+        });
+
+        // locPtrs of staticAgents_inds: _locPtrs[l] - #(from < l)   (histogram of the from locations + scan)
+        histogram(changes, movedOut, _locN + 1, 3, [](int* h, const LocChange& lch){
+            h[lch.from + 1]++;
+        });
+        std::inclusive_scan(std::execution::par, movedOut.begin(), movedOut.end(), locPtrs_shifts.begin());
+        std::transform(std::execution::par_unseq, _locPtrs.begin(), _locPtrs.end(), locPtrs_shifts.begin(), locPtrs_stat.begin(), [](int lPtr, int shift){
+            return lPtr - shift;
+        });
+
+        // movingAgents_toInds   !!! : changes must be sorted by 1. to 2. agent
+        std::transform(std::execution::par_unseq, changes.begin(), changes.end(), movingAgents_toInds.begin(), [&](const LocChange& lch){
+            int i = &lch - changes.begin();
+            auto ptr = std::lower_bound(staticAgents_inds.begin() + locPtrs_stat[lch.to], staticAgents_inds.begin() + locPtrs_stat[lch.to + 1], lch.agent, [&](std::pair<int,int> agent_ind, int agent){
+                return agent_ind.first < agent;
+            });
+            int toInd = std::distance(staticAgents_inds.begin(), ptr);
+            return std::make_pair(lch.agent, toInd + i);   // +i is because of the "self shift"
+        });
+
+        // (INSERTION) the jth free slot (same compaction, now over the free slots) gets the jth static agent
+        std::fill(std::execution::par_unseq, keepFlags.begin(), keepFlags.end(), 1);
+        std::for_each(std::execution::par_unseq, movingAgents_toInds.begin(), movingAgents_toInds.end(), [&](std::pair<int,int> agent_ind){
+            keepFlags[agent_ind.second] = 0;
+        });
+        compaction::compact(keepFlags.data(), keepRanks.data(), _agentN, [&](long int slot, int rank){
+            agentsOut[slot] = staticAgents_inds[rank].first;
+        });
+
+        // Insert movingAgents into agentsOut
+        std::for_each(std::execution::par_unseq, movingAgents_toInds.begin(), movingAgents_toInds.end(), [&](std::pair<int,int> agent_ind){
+            agentsOut[agent_ind.second] = agent_ind.first;
+        });
+
+        auto t_agents_end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration_cast<time_unit_t>( t_agents_end - t_agents_begin ).count();
+    }
+
+    // reads _agents, _pos, _locations (into the static stream), writes agentsOut, locationsOut (may be the same arrays)
+    long int update_agents_MERGE(sorting::span<const LocChange> changes, std::vector<int>& agentsOut, std::vector<int>& locationsOut){
+        long int changeN = changes.size();
+        long int staticN = _agentN - changeN;
+
+        std::vector<uint64_t>& staticKeys = _ws.buffer<uint64_t>(0, staticN);   // (location, agent) packed
+        std::vector<uint64_t>& movingKeys = _ws.buffer<uint64_t>(1, changeN);   // (to, agent) packed
+        std::vector<int>& movingAgents_fromSlots = _ws.buffer<int>(0, changeN);
+        std::vector<int>& keepFlags              = _ws.buffer<int>(6, _agentN);
+        std::vector<int>& keepRanks              = _ws.buffer<int>(7, _agentN);
+
+        auto t_agents_begin = std::chrono::high_resolution_clock::now();
+
+        std::for_each(std::execution::par_unseq, changes.begin(), changes.end(), [&](const LocChange& lch){
+            long int i = &lch - changes.begin();
+            movingAgents_fromSlots[i] = _pos[lch.agent];
+            movingKeys[i] = sorting::pack_key_value(lch.to, lch.agent);
+        });
+
+        // static stream: sorted, as _agents is
+        compaction::keep_flags_except(keepFlags.data(), _agentN, movingAgents_fromSlots.data(), changeN);
+        compaction::compact(keepFlags.data(), keepRanks.data(), _agentN, [&](long int oldInd, int newInd){
+            int agent = _agents[oldInd];
+            staticKeys[newInd] = sorting::pack_key_value(_compact ? _locationOfAgent[agent] : _locations[oldInd], agent);  // static: same location
+        });
+
+        // moving stream: C log C (nothing to do if the changes came sorted)
+        if(!std::is_sorted(std::execution::par, movingKeys.begin(), movingKeys.end()))
+            std::sort(std::execution::par, movingKeys.begin(), movingKeys.end());
+
+        int* agentsDst = agentsOut.data();
+        int* locationsDst = _compact ? nullptr : locationsOut.data();
+        merging::parallel_merge(staticKeys.data(), staticN, movingKeys.data(), changeN, std::less<uint64_t>(), [=](long int k, uint64_t key){
+            if(locationsDst)
+                locationsDst[k] = sorting::unpacked_key(key);
+            agentsDst[k] = sorting::unpacked_value(key);
+        });
+
+        auto t_agents_end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration_cast<time_unit_t>( t_agents_end - t_agents_begin ).count();
+    }
+
+    // locationsOut from the new locPtrs - outside the touched locations it is the same as _locations (the back buffer is
+    // brought up to date there by sync_back_buffers)
+    long int update_locations(std::pair<int,int> touched, const std::vector<int>& locPtrsNew, std::vector<int>& locationsOut){
+        auto t_locations_begin = std::chrono::high_resolution_clock::now();
+        if(touched.second < 0)
+            touched = std::make_pair(0, -1);
+        sorting::expandKeyPtrs(locPtrsNew, locationsOut, touched.first, touched.second + 1);  // element-parallel segmented fill
+        auto t_locations_end = std::chrono::high_resolution_clock::now();
+
+        return std::chrono::duration_cast<time_unit_t>( t_locations_end - t_locations_begin ).count();
+    }
+};
+
+#endif //LOCATION_INDEX_H
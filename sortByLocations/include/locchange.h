@@ -0,0 +1,96 @@
+#ifndef LOC_CHANGE_H
+#define LOC_CHANGE_H
+
+#ifndef GPU
+// for CPU:
+#include <pstl/algorithm>
+#include <pstl/execution>
+#else
+// for GPU:
+#include <algorithm>
+#include <execution>
+#endif
+
+#include <vector>
+#include <cstdint>
+#include <iostream>
+
+#include "counterrng.h"
+#include "span.h"
+
+struct LocChange{
+    int agent;
+    int from; // from location ID
+    int to;   // to location ID
+    LocChange() : agent(-1), from(-1), to(-1){}
+    LocChange(int agent_, int from_, int to_) : agent(agent_), from(from_), to(to_){}
+    void PRINT(){ std::cout << agent << "\t[ " << from << "\t" << to << " ]\n"; }
+};
+
+// the order the location indices expect: 1. to 2. agent
+inline void sort_loc_changes(std::vector<LocChange>& changes){
+    std::sort(std::execution::par, changes.begin(), changes.end(), [](const LocChange& lch1, const LocChange& lch2){
+        if(lch1.to != lch2.to)
+            return lch1.to < lch2.to;
+        return lch1.agent < lch2.agent;
+    });
+}
+
+// initial placement: every agent at a uniform random location, deterministic in seed (stream 2, gen_loc_changes uses 0 and 1)
+inline void gen_locations(std::vector<int>& locationOfAgent, int locN, uint64_t seed){
+    long int agentN = locationOfAgent.size();
+    #pragma omp parallel for schedule(static)
+    for(long int agent = 0; agent < agentN; agent++)
+        locationOfAgent[agent] = counter_rng::uniform(seed, 0, agent, 2, locN);
+}
+
+// changeN distinct random movers with random destinations, deterministic in (seed, tick), sorted with sort_loc_changes
+//  movers:       Floyd's sampling - for j = N-C .. N-1 a random t in [0, j] is taken, or j if t is taken already: a distinct,
+//                uniform sample in O(C) (serial: every draw depends on the earlier ones, the draws themselves are counter-based)
+//  destinations: counter-based random keyed on (seed, tick, agent), never the current location
+//  taken:        scratch, the hash set of the sample (open addressing, O(changeN))
+//  changeN is clamped to the number of agents; with less than 2 locations nobody can move (no changes)
+inline std::vector<LocChange> gen_loc_changes(sorting::span<const int> locationOfAgent, int locN, int changeN, uint64_t seed, uint64_t tick,
+                                              std::vector<uint64_t>& taken){
+    long int agentN = locationOfAgent.size();
+    changeN = std::max(0L, std::min<long int>(changeN, agentN));
+    if(locN < 2)
+        changeN = 0;
+
+    long int tableN = 2;
+    while(tableN < 2L * changeN)
+        tableN <<= 1;
+    taken.assign(tableN, 0);  // agent + 1, 0: empty
+    auto insert = [&](long int agent){
+        uint64_t h = counter_rng::mix(agent) & (tableN - 1);
+        for(; taken[h] != 0; h = (h + 1) & (tableN - 1))
+            if(taken[h] == (uint64_t)agent + 1)
+                return false;
+        taken[h] = agent + 1;
+        return true;
+    };
+
+    std::vector<LocChange> changes(changeN);
+    for(long int j = agentN - changeN, c = 0; j < agentN; j++, c++){
+        long int t = counter_rng::uniform(seed, tick, j, 0, j + 1);
+        if(!insert(t)){
+            insert(j);  // j was not drawn before: the earlier draws are all below j
+            t = j;
+        }
+        changes[c].agent = t;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for(int c = 0; c < changeN; c++){
+        int agent = changes[c].agent;
+        int from = locationOfAgent[agent];
+        int to = counter_rng::uniform(seed, tick, agent, 1, locN - 1);
+        if(to >= from)
+            to++;
+        changes[c] = LocChange(agent, from, to);
+    }
+    sort_loc_changes(changes);
+    return changes;
+}
+
+#endif //LOC_CHANGE_H
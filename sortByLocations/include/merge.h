@@ -0,0 +1,106 @@
+#ifndef MERGE_H
+#define MERGE_H
+
+#include <vector>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// parallel merge with merge path partitioning:
+//  output index range [0, na+nb) is cut into equal parts, the split point of every cut in a and b is found with one binary
+//  search along the cross diagonal, then every part is merged sequentially and independently.
+namespace merging{
+
+    // number of elements taken from a among the first `diag` outputs (stable: on ties a goes first)
+    template<typename T, typename Comp>
+    long int merge_path(const T* a, long int na, const T* b, long int nb, long int diag, Comp comp){
+        long int lo = std::max(0L, diag - nb);
+        long int hi = std::min(diag, na);
+        while(lo < hi){
+            long int mid = (lo + hi) / 2;
+            if(!comp(b[diag - mid - 1], a[mid]))   // a[mid] <= b[diag - mid - 1]  ->  a[mid] is among the first diag
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    // sequential merge of a[ia, iaEnd) and b[ib, ibEnd), out(k, value) for the output index k
+    template<typename T, typename Comp, typename Out>
+    void merge_range(const T* a, long int ia, long int iaEnd, const T* b, long int ib, long int ibEnd, long int k, Comp comp, Out& out){
+        while(ia < iaEnd && ib < ibEnd){
+            if(comp(b[ib], a[ia]))
+                out(k++, b[ib++]);
+            else
+                out(k++, a[ia++]);
+        }
+        while(ia < iaEnd)
+            out(k++, a[ia++]);
+        while(ib < ibEnd)
+            out(k++, b[ib++]);
+    }
+
+    // merges a[0, na) and b[0, nb) in parallel, out(k, value) is called exactly once for every output index k
+    //  (so the output can be scattered into several arrays in the same pass)
+    template<typename T, typename Comp, typename Out>
+    void parallel_merge(const T* a, long int na, const T* b, long int nb, Comp comp, Out out){
+        long int N = na + nb;
+        #pragma omp parallel
+        {
+            int t = 0, nt = 1;
+        #ifdef _OPENMP
+            t = omp_get_thread_num();
+            nt = omp_get_num_threads();
+        #endif
+            long int diagBegin = N * t / nt;
+            long int diagEnd   = N * (t+1) / nt;
+            long int iaBegin = merge_path(a, na, b, nb, diagBegin, comp);
+            long int iaEnd   = merge_path(a, na, b, nb, diagEnd, comp);
+            merge_range(a, iaBegin, iaEnd, b, diagBegin - iaBegin, diagEnd - iaEnd, diagBegin, comp, out);
+        }
+    }
+
+    template<typename T, typename Comp>
+    void parallel_merge(const T* a, long int na, const T* b, long int nb, T* dst, Comp comp){
+        parallel_merge(a, na, b, nb, comp, [dst](long int k, const T& value){ dst[k] = value; });
+    }
+
+    // one round of pairwise merges of the sorted runs in src: [runStarts[r], runStarts[r+1]) -> dst, the run count halves
+    //  many pairs: the pairs are distributed over the threads, few pairs: every pair is merged with all threads
+    template<typename T, typename Comp>
+    void merge_runs_round(const T* src, T* dst, std::vector<long int>& runStarts, Comp comp){
+        long int R = runStarts.size() - 1;
+        long int pairs = (R + 1) / 2;
+        int threads = 1;
+    #ifdef _OPENMP
+        threads = omp_get_max_threads();
+    #endif
+        if(pairs >= threads){
+            #pragma omp parallel for schedule(dynamic)
+            for(long int p = 0; p < pairs; p++){
+                long int begin = runStarts[2*p];
+                long int mid   = runStarts[std::min(2*p + 1, R)];
+                long int end   = runStarts[std::min(2*p + 2, R)];
+                std::merge(src + begin, src + mid, src + mid, src + end, dst + begin, comp);
+            }
+        }
+        else{
+            for(long int p = 0; p < pairs; p++){
+                long int begin = runStarts[2*p];
+                long int mid   = runStarts[std::min(2*p + 1, R)];
+                long int end   = runStarts[std::min(2*p + 2, R)];
+                parallel_merge(src + begin, mid - begin, src + mid, end - mid, dst + begin, comp);
+            }
+        }
+        // every second boundary disappears
+        long int newR = pairs;
+        for(long int p = 0; p <= newR; p++)
+            runStarts[p] = runStarts[std::min(2*p, R)];
+        runStarts.resize(newR + 1);
+    }
+
+} // namespace merging
+
+#endif //MERGE_H
@@ -4,61 +4,93 @@
 #define PAIRED_VECTOR_ITERATOR_H
 
 
-#include <boost/tuple/tuple.hpp>
+#include <vector>
+#include <iterator>
+#include <cstddef>
+#include <utility>
 
 
+// value_type of the paired vectors: a copy of the ith key and value (this is what the comparator gets)
+struct PairedValue{
+    int key;
+    int val;
+};
+
+inline bool operator< (const PairedValue& lhs, const PairedValue& rhs){
+    if (lhs.key == rhs.key)
+        return lhs.val < rhs.val;
+    return lhs.key < rhs.key;
+}
+
+
+// reference type of the paired vectors: proxy to the ith key and value
+//  - assigning to it writes through to both vectors
+//  - converts to PairedValue, so the comparators can take PairedValue by value
+//  - swap() is found by ADL from std::iter_swap (std::swap doesn't work on proxies - see the old error below)
+//      /usr/include/c++/4.8.5/bits/stl_algobase.h(147): error: no instance of overloaded function "std::swap" matches the argument list
+class PairedReference{
+    int* _key;
+    int* _val;
+
+public:
+    PairedReference(int* key, int* val) : _key(key), _val(val){}
+    PairedReference(const PairedReference& other) = default;
+
+    operator PairedValue() const{
+        return PairedValue{*_key, *_val};
+    }
+
+    PairedReference& operator= (const PairedValue& rhs){
+        *_key = rhs.key;
+        *_val = rhs.val;
+        return *this;
+    }
+
+    PairedReference& operator= (const PairedReference& rhs){ // assigns the referred values, not the pointers
+        *_key = *rhs._key;
+        *_val = *rhs._val;
+        return *this;
+    }
+
+    int& key() const{ return *_key; }
+    int& val() const{ return *_val; }
+
+    friend void swap(PairedReference lhs, PairedReference rhs){
+        std::swap(*lhs._key, *rhs._key);
+        std::swap(*lhs._val, *rhs._val);
+    }
+};
+
+
+// random access iterator over two equally long vectors - sorts both in place (SoA), without a temporary pair vector
 class PairedVectorIterator{
-  // TODO: operator[] for GPU
-    
-    std::vector<int>& vals;
-    std::vector<int>& indices;
-    std::size_t index;
-    
+    int* keys;
+    int* vals;
+    std::ptrdiff_t index;
+
 public:
-    PairedVectorIterator(int index, std::vector<int>& data_, std::vector<int>& data2_)
-        : index(index),
-        indices(data_),
-        vals(data2_)
+    using difference_type = std::ptrdiff_t;
+    using value_type = PairedValue;
+    using pointer = void;
+    using reference = PairedReference;
+    using iterator_category = std::random_access_iterator_tag;
+
+    PairedVectorIterator() : keys(nullptr), vals(nullptr), index(0){}
+
+    PairedVectorIterator(difference_type index, std::vector<int>& keys_, std::vector<int>& vals_)
+        : keys(keys_.data()),
+        vals(vals_.data()),
+        index(index)
     {
-        //_ASSERT(data_.size() == data2_.size());
-    }
-    
-
-    boost::tuple<int&,int&> operator*(){
-        //std::pair<int&,int&> r (&(indices[index]), &(vals[index]));  // valami ilyesmi kne hogy cm szerint adjuk t
-        //std::pair<int,int> r = std::make_pair(indices[index], vals[index]);
-        boost::tuple<int&,int&> r (indices[index], vals[index]); 
-        return r;
-    }
-    //ez lenne a j  -- de nem tud swapolni mert nincs definilva std::pair-ra --- t kne rni (template specializci)
-    // Error:
-    // /usr/include/c++/4.8.5/bits/stl_algobase.h(147): error: no instance of overloaded function "std::swap" matches the argument list
-    //       argument types are: (std::pair<int, int>, std::pair<int, int>)
-    //   swap(*__a, *__b);
-    //   ^
-
-/*
-    int& operator*(){
-    
-    
-        //-------Probalgatasok:--------
-    
-        //std::vector<int&> r;// (indices[index], vals[index]); 
-        //std::tuple <char, int&, float> geek; 
-        //int& a;
-        
-        //SIKERR: boost::tuple<int&,int&> r (indices[index], vals[index]); 
-        
-    
-        
-        //---------------
-    
-    
-        return indices[index];
-    }
-*/
-    const int& operator*() const{
-        return indices[index];
+        //_ASSERT(keys_.size() == vals_.size());
+    }
+
+    reference operator*() const{
+        return PairedReference(keys + index, vals + index);
+    }
+
+    reference operator[](difference_type n) const{
+        return PairedReference(keys + index + n, vals + index + n);
     }
 
     PairedVectorIterator& operator++(){
@@ -71,39 +103,42 @@ public:
         return *this;
     }
 
-    PairedVectorIterator& operator= (const PairedVectorIterator& rhs){
-        index = rhs.index;
-        vals = rhs.vals;
-        indices = rhs.indices;
+    PairedVectorIterator operator++(int){
+        PairedVectorIterator tmp = *this;
+        index++;
+        return tmp;
+    }
+
+    PairedVectorIterator operator--(int){
+        PairedVectorIterator tmp = *this;
+        index--;
+        return tmp;
+    }
 
+    PairedVectorIterator& operator+= (difference_type rhs){
+        index += rhs;
         return *this;
     }
-    
-    friend int operator- (const PairedVectorIterator& lhs, const PairedVectorIterator& rhs){
-        return lhs.index - rhs.index;
-    }
-    
 
-    friend PairedVectorIterator operator-(PairedVectorIterator const& lhs, int rhs){
-        return PairedVectorIterator(lhs.index - rhs, lhs.vals, lhs.indices);
+    PairedVectorIterator& operator-= (difference_type rhs){
+        index -= rhs;
+        return *this;
     }
 
-    friend PairedVectorIterator operator+(PairedVectorIterator const& lhs, int rhs){
-        return PairedVectorIterator(lhs.index + rhs, lhs.vals, lhs.indices);
+    friend difference_type operator- (const PairedVectorIterator& lhs, const PairedVectorIterator& rhs){
+        return lhs.index - rhs.index;
     }
 
-    friend PairedVectorIterator operator+(int lhs, PairedVectorIterator const& rhs){
-        return PairedVectorIterator(lhs + rhs.index, rhs.vals, rhs.indices);
+    friend PairedVectorIterator operator-(PairedVectorIterator lhs, difference_type rhs){
+        return lhs -= rhs;
     }
 
-    friend PairedVectorIterator& operator+= (PairedVectorIterator& lhs, const int& rhs){
-        lhs.index += rhs;
-        return lhs;
+    friend PairedVectorIterator operator+(PairedVectorIterator lhs, difference_type rhs){
+        return lhs += rhs;
     }
 
-    friend PairedVectorIterator& operator-= (PairedVectorIterator& lhs, const int& rhs){
-        lhs.index -= rhs;
-        return lhs;
+    friend PairedVectorIterator operator+(difference_type lhs, PairedVectorIterator rhs){
+        return rhs += lhs;
     }
 
     friend bool operator== (const PairedVectorIterator& lhs, const PairedVectorIterator& rhs){
@@ -125,12 +160,10 @@ public:
     friend bool operator< (const PairedVectorIterator& lhs, const PairedVectorIterator& rhs){
         return lhs.index < rhs.index;
     }
-    
-    using difference_type = int;
-    using value_type = boost::tuple<int&,int&>; //int& //std::pair<int,int>;
-    using pointer = int*;
-    using reference = int&;
-    using iterator_category = std::random_access_iterator_tag;
+
+    friend bool operator> (const PairedVectorIterator& lhs, const PairedVectorIterator& rhs){
+        return lhs.index > rhs.index;
+    }
 
 };
 
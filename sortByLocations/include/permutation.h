@@ -0,0 +1,79 @@
+#ifndef PERMUTATION_H
+#define PERMUTATION_H
+
+#ifndef GPU
+// for CPU:
+#include <pstl/algorithm>
+#include <pstl/execution>
+#else
+// for GPU:
+#include <algorithm>
+#include <execution>
+#endif
+
+#include <vector>
+#include <tuple>
+#include <utility>
+
+// applying a permutation (e.g. the result of an argsort) to any number of payload columns:
+//      column[i] = old_column[perm[i]]
+namespace permutation{
+
+    const int PREFETCH_DISTANCE = 16;   // gather: how many rows ahead the sources are prefetched
+
+    template<typename T>
+    inline void prefetch(const T* ptr){
+    #if defined(__GNUC__) && !defined(GPU)
+        __builtin_prefetch(ptr);
+    #endif
+    }
+
+    template<typename SrcTuple, typename DstTuple, std::size_t... I>
+    void gather_impl(const int* perm, long int N, SrcTuple src, DstTuple dst, std::index_sequence<I...>){
+        #pragma omp parallel for schedule(static)
+        for(long int i = 0; i < N; i++){
+            if(i + PREFETCH_DISTANCE < N){
+                long int ahead = perm[i + PREFETCH_DISTANCE];
+                (prefetch(std::get<I>(src) + ahead), ...);
+            }
+            long int from = perm[i];
+            ((std::get<I>(dst)[i] = std::get<I>(src)[from]), ...);
+        }
+    }
+
+    // parallel gather of all columns in one pass: std::get<c>(dst)[i] = std::get<c>(src)[perm[i]]
+    //  src, dst: tuples of pointers, e.g. std::make_tuple(keys.data(), values.data())
+    template<typename SrcTuple, typename DstTuple>
+    void gather(const int* perm, long int N, SrcTuple src, DstTuple dst){
+        static_assert(std::tuple_size<SrcTuple>::value == std::tuple_size<DstTuple>::value, "gather: column count mismatch");
+        gather_impl(perm, N, src, dst, std::make_index_sequence<std::tuple_size<SrcTuple>::value>());
+    }
+
+    // in place: follows the cycles of perm, needs only N bits + one element per column extra memory
+    //  serial: a cycle is only found by walking it, so the threads would have to claim the cycles (atomic flags per element)
+    //  - this is the variant for when the N-sized buffers of gather() don't fit, not the fast one
+    template<typename... Ts>
+    void apply_permutation_inplace(const std::vector<int>& perm, std::vector<Ts>&... columns){
+        long int N = perm.size();
+        std::vector<bool> done(N, false);
+        for(long int start = 0; start < N; start++){
+            if(done[start])
+                continue;
+            std::tuple<Ts...> first(columns[start]...);
+            long int i = start;
+            while(true){
+                done[i] = true;
+                long int from = perm[i];
+                if(from == start){
+                    std::apply([&](Ts&... firstVals){ ((columns[i] = firstVals), ...); }, first);
+                    break;
+                }
+                ((columns[i] = columns[from]), ...);
+                i = from;
+            }
+        }
+    }
+
+} // namespace permutation
+
+#endif //PERMUTATION_H
@@ -0,0 +1,194 @@
+#ifndef SIMDSORT_H
+#define SIMDSORT_H
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+// bitonic sorting network for small blocks (16..256) of packed 64 bit key/values - the base case of the merge sorts
+//  - AVX-512 (F + VL) or AVX2 kernel, picked at runtime with CPUID (__builtin_cpu_supports), scalar network otherwise
+//  - the kernels are compiled with target attributes, so no -mavx2 / -xHOST is needed for this file
+//  ascending, unsigned 64 bit order
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(GPU)
+#define SIMDSORT_X86
+#include <immintrin.h>
+#endif
+
+namespace simdsort{
+
+    const int MIN_BLOCK = 16;
+    const int MAX_BLOCK = 256;
+
+    // branchless compare-exchange network, n is a power of two
+    inline void bitonic_sort_scalar(uint64_t* a, int n){
+        for(int k = 2; k <= n; k <<= 1){
+            for(int j = k >> 1; j > 0; j >>= 1){
+                for(int i = 0; i < n; i++){
+                    int l = i ^ j;
+                    if(l > i){
+                        uint64_t x = a[i], y = a[l];
+                        uint64_t mn = x < y ? x : y;
+                        uint64_t mx = x < y ? y : x;
+                        bool asc = (i & k) == 0;
+                        a[i] = asc ? mn : mx;
+                        a[l] = asc ? mx : mn;
+                    }
+                }
+            }
+        }
+    }
+
+#ifdef SIMDSORT_X86
+
+    // AVX2 has only signed 64 bit compares: the sign bits are flipped while sorting
+    __attribute__((target("avx2")))
+    inline void minmax_avx2(__m256i a, __m256i b, __m256i& mn, __m256i& mx){
+        __m256i gt = _mm256_cmpgt_epi64(a, b);
+        mn = _mm256_blendv_epi8(a, b, gt);
+        mx = _mm256_blendv_epi8(b, a, gt);
+    }
+
+    // stages with j = 2 and j = 1 inside one 4 lane register starting at index i
+    __attribute__((target("avx2")))
+    inline __m256i inregister_avx2(__m256i v, int i, int k, int j){
+        __m256i mn, mx;
+        if(j == 2){
+            minmax_avx2(v, _mm256_permute4x64_epi64(v, 0x4E), mn, mx);   // lanes (0,2) (1,3)
+            return (i & k) == 0 ? _mm256_blend_epi32(mn, mx, 0xF0) : _mm256_blend_epi32(mx, mn, 0xF0);
+        }
+        minmax_avx2(v, _mm256_permute4x64_epi64(v, 0xB1), mn, mx);       // lanes (0,1) (2,3)
+        if(k == 2)                                                       // direction changes inside the register
+            return _mm256_blend_epi32(mn, mx, 0x3C);
+        return (i & k) == 0 ? _mm256_blend_epi32(mn, mx, 0xCC) : _mm256_blend_epi32(mx, mn, 0xCC);
+    }
+
+    __attribute__((target("avx2")))
+    inline void bitonic_sort_avx2(uint64_t* a, int n){
+        const __m256i sign = _mm256_set1_epi64x((long long)0x8000000000000000ULL);
+        for(int i = 0; i < n; i += 4){
+            __m256i* p = (__m256i*)(a + i);
+            _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), sign));
+        }
+        for(int k = 2; k <= n; k <<= 1){
+            for(int j = k >> 1; j > 0; j >>= 1){
+                if(j >= 4){
+                    for(int base = 0; base < n; base += 2*j){
+                        for(int i = base; i < base + j; i += 4){
+                            __m256i* pi = (__m256i*)(a + i);
+                            __m256i* pl = (__m256i*)(a + i + j);
+                            __m256i mn, mx;
+                            minmax_avx2(_mm256_loadu_si256(pi), _mm256_loadu_si256(pl), mn, mx);
+                            bool asc = (i & k) == 0;
+                            _mm256_storeu_si256(pi, asc ? mn : mx);
+                            _mm256_storeu_si256(pl, asc ? mx : mn);
+                        }
+                    }
+                }
+                else{
+                    for(int i = 0; i < n; i += 4){
+                        __m256i* p = (__m256i*)(a + i);
+                        _mm256_storeu_si256(p, inregister_avx2(_mm256_loadu_si256(p), i, k, j));
+                    }
+                }
+            }
+        }
+        for(int i = 0; i < n; i += 4){
+            __m256i* p = (__m256i*)(a + i);
+            _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), sign));
+        }
+    }
+
+    // AVX-512: unsigned compares, 8 lanes for j >= 8, 4 lane registers for the j <= 4 stages
+    __attribute__((target("avx512f,avx512vl")))
+    inline __m256i inregister_avx512(__m256i v, int i, int k, int j){
+        __m256i perm = j == 2 ? _mm256_permute4x64_epi64(v, 0x4E) : _mm256_permute4x64_epi64(v, 0xB1);
+        __m256i mn = _mm256_min_epu64(v, perm);
+        __m256i mx = _mm256_max_epu64(v, perm);
+        if(j == 2)
+            return (i & k) == 0 ? _mm256_blend_epi32(mn, mx, 0xF0) : _mm256_blend_epi32(mx, mn, 0xF0);
+        if(k == 2)
+            return _mm256_blend_epi32(mn, mx, 0x3C);
+        return (i & k) == 0 ? _mm256_blend_epi32(mn, mx, 0xCC) : _mm256_blend_epi32(mx, mn, 0xCC);
+    }
+
+    __attribute__((target("avx512f,avx512vl")))
+    inline void bitonic_sort_avx512(uint64_t* a, int n){
+        for(int k = 2; k <= n; k <<= 1){
+            for(int j = k >> 1; j > 0; j >>= 1){
+                if(j >= 8){
+                    for(int base = 0; base < n; base += 2*j){
+                        for(int i = base; i < base + j; i += 8){
+                            // one compare mask in the direction of the block and two blends - _mm512_min/max_epu64 leave
+                            // their pass-through operand undefined (-Wmaybe-uninitialized with GCC)
+                            __m512i x = _mm512_loadu_si512(a + i);
+                            __m512i y = _mm512_loadu_si512(a + i + j);
+                            bool asc = (i & k) == 0;
+                            __mmask8 swap = asc ? _mm512_cmpgt_epu64_mask(x, y) : _mm512_cmplt_epu64_mask(x, y);
+                            _mm512_storeu_si512(a + i, _mm512_mask_blend_epi64(swap, x, y));
+                            _mm512_storeu_si512(a + i + j, _mm512_mask_blend_epi64(swap, y, x));
+                        }
+                    }
+                }
+                else if(j == 4){
+                    for(int base = 0; base < n; base += 8){
+                        __m256i* pi = (__m256i*)(a + base);
+                        __m256i* pl = (__m256i*)(a + base + 4);
+                        __m256i x = _mm256_loadu_si256(pi);
+                        __m256i y = _mm256_loadu_si256(pl);
+                        __m256i mn = _mm256_min_epu64(x, y);
+                        __m256i mx = _mm256_max_epu64(x, y);
+                        bool asc = (base & k) == 0;
+                        _mm256_storeu_si256(pi, asc ? mn : mx);
+                        _mm256_storeu_si256(pl, asc ? mx : mn);
+                    }
+                }
+                else{
+                    for(int i = 0; i < n; i += 4){
+                        __m256i* p = (__m256i*)(a + i);
+                        _mm256_storeu_si256(p, inregister_avx512(_mm256_loadu_si256(p), i, k, j));
+                    }
+                }
+            }
+        }
+    }
+
+#endif // SIMDSORT_X86
+
+    typedef void (*network_t)(uint64_t*, int);
+
+    inline network_t select_network(){
+    #ifdef SIMDSORT_X86
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl"))
+            return bitonic_sort_avx512;
+        if(__builtin_cpu_supports("avx2"))
+            return bitonic_sort_avx2;
+    #endif
+        return bitonic_sort_scalar;
+    }
+
+    inline const char* network_name(){
+        network_t network = select_network();
+    #ifdef SIMDSORT_X86
+        if(network == bitonic_sort_avx512) return "avx512";
+        if(network == bitonic_sort_avx2)   return "avx2";
+    #endif
+        return "scalar";
+    }
+
+    // sorts a[0, n), n <= MAX_BLOCK: padded with UINT64_MAX to a power of two (at least MIN_BLOCK), then the network
+    inline void sort_block(uint64_t* a, int n){
+        static const network_t network = select_network();
+        alignas(64) uint64_t block[MAX_BLOCK];
+        int size = MIN_BLOCK;
+        while(size < n)
+            size <<= 1;
+        std::memcpy(block, a, n * sizeof(uint64_t));
+        std::fill(block + n, block + size, UINT64_MAX);
+        network(block, size);
+        std::memcpy(a, block, n * sizeof(uint64_t));
+    }
+
+} // namespace simdsort
+
+#endif //SIMDSORT_H
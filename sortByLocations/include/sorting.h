@@ -15,16 +15,49 @@
 
 #include <vector>
 #include <chrono>
+#include <cstdint>
+#include <type_traits>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include <boost/iterator/zip_iterator.hpp>
 #include <boost/tuple/tuple.hpp>
 
 #include "pairedvectoriterator.h" // implemented by me and Kompi
+#include "permutation.h"
+#include "workspace.h"
+#include "span.h"
+#include "merge.h"
+#include "simdsort.h"
 #include "tupleit.hh"  // a boost::tuple iterator, implemented by Anthony Williams  - https://pastebin.com/LFkTHdQk  
 
 using time_unit_t2 = std::chrono::milliseconds;
 
 namespace sorting{
 
+    // OpenMP thread helpers (1 thread without OpenMP)
+    inline int max_threads(){
+    #ifdef _OPENMP
+        return omp_get_max_threads();
+    #else
+        return 1;
+    #endif
+    }
+    inline int thread_num(){
+    #ifdef _OPENMP
+        return omp_get_thread_num();
+    #else
+        return 0;
+    #endif
+    }
+    inline int num_threads(){
+    #ifdef _OPENMP
+        return omp_get_num_threads();
+    #else
+        return 1;
+    #endif
+    }
+
     float generateKeyPtrs(const std::vector<int>& sortedKeys, std::vector<int>& keyPtrs){ // keyPtrs.size() = keyN
         // lower_bound - find_first_occurance of key (or that what is grater than it. (<=)) algorithm wit binary search (we utilise that the input is sorted)    
         int keyN = keyPtrs.size();
@@ -41,6 +74,150 @@ namespace sorting{
         return time;
     }   
 
+    float generateKeyPtrs_BOUNDARY_SCAN(const std::vector<int>& sortedKeys, std::vector<int>& keyPtrs){ // keyPtrs.size() = keyN
+        // streaming version: every neighbouring pair (sortedKeys[i-1], sortedKeys[i]) writes the ptrs of the keys between them
+        //  -> keys in (sortedKeys[i-1], sortedKeys[i]] start at i  (also the empty ones), keys above the last one at N
+        long int N = sortedKeys.size();
+        int keyN = keyPtrs.size();
+        auto t_begin = std::chrono::high_resolution_clock::now();
+
+        #pragma omp parallel for schedule(static)
+        for(long int i = 0; i <= N; i++){
+            int lo = (i == 0) ? 0        : sortedKeys[i-1] + 1;
+            int hi = (i == N) ? keyN - 1 : std::min(sortedKeys[i], keyN - 1);
+            for(int key = lo; key <= hi; key++)
+                keyPtrs[key] = i;
+        }
+
+        auto t_end = std::chrono::high_resolution_clock::now();
+        float time = std::chrono::duration_cast<time_unit_t2>(t_end-t_begin).count();
+        return time;
+    }
+
+    enum KeyPtrsAlg { KEYPTRS_LOWER_BOUND, KEYPTRS_BOUNDARY_SCAN };
+
+    // inverse of generateKeyPtrs (segmented fill): keys[p] = key for p in [keyPtrs[key], keyPtrs[key+1]), for the keys in [beginKey, endKey)
+    //  element-parallel: [keyPtrs[beginKey], keyPtrs[endKey]) is cut into equal chunks, every chunk finds its first key with one
+    //  upper_bound on keyPtrs and walks forward - balanced even if the segment sizes are skewed
+    float expandKeyPtrs(const std::vector<int>& keyPtrs, std::vector<int>& keys, int beginKey, int endKey){
+        auto t_begin = std::chrono::high_resolution_clock::now();
+
+        if(beginKey < endKey){
+            long int pBegin = keyPtrs[beginKey];
+            long int pEnd   = keyPtrs[endKey];
+            #pragma omp parallel
+            {
+                int t = thread_num();
+                int nt = num_threads();
+                long int begin = pBegin + (pEnd - pBegin) * t / nt;
+                long int end   = pBegin + (pEnd - pBegin) * (t+1) / nt;
+                if(begin < end){
+                    // last key that starts at or before begin
+                    int key = std::distance(keyPtrs.begin(), std::upper_bound(keyPtrs.begin() + beginKey, keyPtrs.begin() + endKey + 1, begin)) - 1;
+                    for(long int p = begin; p < end; key++){
+                        long int segEnd = std::min<long int>(keyPtrs[key + 1], end);
+                        std::fill(keys.begin() + p, keys.begin() + segEnd, key);
+                        p = std::max(p, segEnd);
+                    }
+                }
+            }
+        }
+
+        auto t_end = std::chrono::high_resolution_clock::now();
+        float time = std::chrono::duration_cast<time_unit_t2>(t_end-t_begin).count();
+        return time;
+    }
+
+    float expandKeyPtrs(const std::vector<int>& keyPtrs, std::vector<int>& keys){
+        return expandKeyPtrs(keyPtrs, keys, 0, (int)keyPtrs.size() - 1);
+    }
+
+    float generateKeyPtrs(const std::vector<int>& sortedKeys, std::vector<int>& keyPtrs, KeyPtrsAlg alg){
+        if(alg == KEYPTRS_BOUNDARY_SCAN)
+            return generateKeyPtrs_BOUNDARY_SCAN(sortedKeys, keyPtrs);
+        return generateKeyPtrs(sortedKeys, keyPtrs);
+    }
+
+
+
+
+    //---------------- RADIX sort engine ----------------------------------------------------------
+    //  LSD radix sort on non-negative integral keys with an optional payload array (vals may be nullptr).
+    //  One pass: per-thread digit histograms -> prefix sum over (digit, thread) -> stable parallel scatter.
+    //  Only the digits in [beginBit, endBit) are sorted, so the bits above the highest set key bit are skipped.
+
+    const int RADIX_BITS = 8;
+    const int RADIX_BUCKETS = 1 << RADIX_BITS;
+
+    // number of bits needed to represent x  (0 -> 0, 1 -> 1, 5 -> 3, ...)
+    inline int bit_width(unsigned long long x){
+        int bits = 0;
+        while(x){ bits++; x >>= 1; }
+        return bits;
+    }
+
+    template<typename K, typename V>
+    void radix_pass(const K* keysIn, const V* valsIn, K* keysOut, V* valsOut, long int N, int shift, std::vector<long int>& hist, int nThreads = 0){
+        using UK = typename std::make_unsigned<K>::type;
+        int T = nThreads > 0 ? nThreads : max_threads();
+        hist.assign((long int)T * RADIX_BUCKETS, 0);
+
+        #pragma omp parallel num_threads(T)
+        {
+            int t = thread_num();
+            int nt = num_threads();
+            long int begin = N * t / nt;
+            long int end   = N * (t+1) / nt;
+            long int* h = &hist[(long int)t * RADIX_BUCKETS];
+
+            // per-thread histogram
+            for(long int i = begin; i < end; i++)
+                h[((UK)keysIn[i] >> shift) & (RADIX_BUCKETS-1)]++;
+            #pragma omp barrier
+
+            // exclusive scan, digit-major so that the scatter stays stable
+            #pragma omp single
+            {
+                long int sum = 0;
+                for(int d = 0; d < RADIX_BUCKETS; d++){
+                    for(int tt = 0; tt < T; tt++){
+                        long int count = hist[(long int)tt * RADIX_BUCKETS + d];
+                        hist[(long int)tt * RADIX_BUCKETS + d] = sum;
+                        sum += count;
+                    }
+                }
+            }
+
+            // scatter
+            for(long int i = begin; i < end; i++){
+                long int dst = h[((UK)keysIn[i] >> shift) & (RADIX_BUCKETS-1)]++;
+                keysOut[dst] = keysIn[i];
+                if(valsIn)
+                    valsOut[dst] = valsIn[i];
+            }
+        }
+    }
+
+    template<typename K, typename V>
+    void radix_sort(K* keys, V* vals, K* tmpKeys, V* tmpVals, long int N, int beginBit, int endBit, int nThreads = 0){
+        std::vector<long int> hist;
+        K* keysIn = keys;    K* keysOut = tmpKeys;
+        V* valsIn = vals;    V* valsOut = vals ? tmpVals : nullptr;
+        for(int shift = beginBit; shift < endBit; shift += RADIX_BITS){
+            radix_pass(keysIn, valsIn, keysOut, valsOut, N, shift, hist, nThreads);
+            std::swap(keysIn, keysOut);
+            std::swap(valsIn, valsOut);
+        }
+        // odd number of passes: the result is in the tmp buffers
+        if(keysIn != keys){
+            #pragma omp parallel for schedule(static) num_threads(nThreads > 0 ? nThreads : max_threads())
+            for(long int i = 0; i < N; i++){
+                keys[i] = keysIn[i];
+                if(vals)
+                    vals[i] = valsIn[i];
+            }
+        }
+    }
 
 
 
@@ -55,10 +232,13 @@ namespace sorting{
         MyPair(int val_, int key_) : val(val_), key(key_){}
     };
 
-    float sort_MY_PAIR(std::vector<int> &values, std::vector<int> &keys){
+    // scratch buffers of the sort_* functions - keep one alive to sort repeatedly without allocations
+    using SortWorkspace = Workspace<int, long int, uint64_t, std::pair<int,int>, MyPair>;
+
+    float sort_MY_PAIR(std::vector<int> &values, std::vector<int> &keys, SortWorkspace &ws){
         //--- Init ---//
         int N = keys.size();
-        std::vector<MyPair> values_keys(N);
+        std::vector<MyPair>& values_keys = ws.buffer<MyPair>(0, N);
         
         //--- Operations - time measuring starts ---//
         auto t_begin = std::chrono::high_resolution_clock::now();
@@ -84,12 +264,16 @@ namespace sorting{
         float time = std::chrono::duration_cast<time_unit_t2>(t_end-t_begin).count();
         return time;
     }
+    float sort_MY_PAIR(std::vector<int> &values, std::vector<int> &keys){
+        SortWorkspace ws;
+        return sort_MY_PAIR(values, keys, ws);
+    }
 
 
-    float sort_STD_PAIR(std::vector<int> &values, std::vector<int> &keys){
+    float sort_STD_PAIR(std::vector<int> &values, std::vector<int> &keys, SortWorkspace &ws){
         //--- Init ---//
         int N = keys.size();
-        std::vector<std::pair<int,int>> values_keys(N);
+        std::vector<std::pair<int,int>>& values_keys = ws.buffer<std::pair<int,int>>(0, N);
         
         //--- Operations - time measuring starts ---//
         auto t_begin = std::chrono::high_resolution_clock::now();
@@ -117,43 +301,545 @@ namespace sorting{
         float time = std::chrono::duration_cast<time_unit_t2>(t_end-t_begin).count();
         return time;
     }
+    float sort_STD_PAIR(std::vector<int> &values, std::vector<int> &keys){
+        SortWorkspace ws;
+        return sort_STD_PAIR(values, keys, ws);
+    }
         
 
-    // TODO sort by both 1. keys and 2. values
-    float sort_HELPER_INDICES_VECTOR(std::vector<int> &values, std::vector<int> &keys){
+    enum PermuteAlg { PERMUTE_GATHER, PERMUTE_INPLACE };
+
+    // argsort by 1. keys 2. values, then both columns are permuted
+    //  PERMUTE_GATHER:  one parallel gather of both columns into workspace buffers
+    //  PERMUTE_INPLACE: cycle-following in place (serial, N bits of extra memory instead of 2 N ints)
+    float sort_HELPER_INDICES_VECTOR(std::vector<int> &values, std::vector<int> &keys, SortWorkspace &ws, PermuteAlg alg = PERMUTE_GATHER){
         //--- Init ---//
         long int N = keys.size();
-        std::vector<int> indices(N);
+        std::vector<int>& indices = ws.buffer<int>(0, N);
         std::iota(indices.begin(), indices.end(), 0);
         
-        int* key_ptr = &keys[0];  
-        
-        std::vector<int> sorted_keys(N);
-        std::vector<int> sorted_values(N);
+        int* key_ptr = keys.data();
+        int* value_ptr = values.data();
+
+        // buffers of the gather (none in place)
+        std::vector<int>* sorted_keys = alg == PERMUTE_GATHER ? &ws.buffer<int>(1, N) : nullptr;
+        std::vector<int>* sorted_values = alg == PERMUTE_GATHER ? &ws.buffer<int>(2, N) : nullptr;
         
         //--- Operations - time measuring starts ---//
         auto t_begin = std::chrono::high_resolution_clock::now();
         
         std::sort(std::execution::par, indices.begin(), indices.end(),
             [=](int a, int b){
+                if (key_ptr[a] == key_ptr[b])
+                    return value_ptr[a] < value_ptr[b];
                 return key_ptr[a] < key_ptr[b];
             }
         );
         
-        // might slow...
-        for(long int i = 0; i<N; i++){
-            sorted_keys[i] = keys[indices[i]];
-            sorted_values[i] = values[indices[i]];
+        if(alg == PERMUTE_INPLACE)
+            permutation::apply_permutation_inplace(indices, keys, values);
+        else{
+            permutation::gather(indices.data(), N, std::make_tuple(key_ptr, value_ptr), std::make_tuple(sorted_keys->data(), sorted_values->data()));
+
+            // no copy back
+            keys.swap(*sorted_keys);
+            values.swap(*sorted_values);
         }
         
-        // copy
-        std::copy(std::execution::par, sorted_keys.begin(), sorted_keys.end(), keys.begin());
-        std::copy(std::execution::par, sorted_values.begin(), sorted_values.end(), values.begin());
-        
         auto t_end = std::chrono::high_resolution_clock::now();
         float time = std::chrono::duration_cast<time_unit_t2>(t_end-t_begin).count();
         return time;
     }
+    float sort_HELPER_INDICES_VECTOR(std::vector<int> &values, std::vector<int> &keys){
+        SortWorkspace ws;
+        return sort_HELPER_INDICES_VECTOR(values, keys, ws);
+    }
+
+    // sort by 1. keys 2. values with the parallel LSD radix engine - keys and values must be non-negative
+    float sort_RADIX(std::vector<int> &values, std::vector<int> &keys, SortWorkspace &ws){
+        //--- Init ---//
+        long int N = keys.size();
+        std::vector<int>& tmp_keys = ws.buffer<int>(0, N);
+        std::vector<int>& tmp_values = ws.buffer<int>(1, N);
+
+        //--- Operations - time measuring starts ---//
+        auto t_begin = std::chrono::high_resolution_clock::now();
+
+        if(N > 0){
+            // tie-break: LSD passes on the values first - skipped if they are already in order (e.g. agents from iota)
+            if(!std::is_sorted(std::execution::par, values.begin(), values.end())){
+                int maxValue = *std::max_element(std::execution::par, values.begin(), values.end());
+                radix_sort(values.data(), keys.data(), tmp_values.data(), tmp_keys.data(), N, 0, bit_width(maxValue));
+            }
+            int maxKey = *std::max_element(std::execution::par, keys.begin(), keys.end());
+            radix_sort(keys.data(), values.data(), tmp_keys.data(), tmp_values.data(), N, 0, bit_width(maxKey));
+        }
+
+        auto t_end = std::chrono::high_resolution_clock::now();
+        float time = std::chrono::duration_cast<time_unit_t2>(t_end-t_begin).count();
+        return time;
+    }
+    float sort_RADIX(std::vector<int> &values, std::vector<int> &keys){
+        SortWorkspace ws;
+        return sort_RADIX(values, keys, ws);
+    }
+
+
+    //---------------- PACKED 64 bit key/value ----------------------------
+    //  (key, value) -> key in the high, value in the low 32 bits, so one integer compare orders by 1. keys 2. values
+
+    inline uint64_t pack_key_value(int key, int value){
+        return ((uint64_t)(uint32_t)key << 32) | (uint32_t)value;
+    }
+    inline int unpacked_key(uint64_t packed){   return (int)(uint32_t)(packed >> 32); }
+    inline int unpacked_value(uint64_t packed){ return (int)(uint32_t)packed; }
+
+    void pack_key_values(const std::vector<int> &values, const std::vector<int> &keys, uint64_t* packed){
+        std::transform(std::execution::par_unseq, keys.begin(), keys.end(), values.begin(), packed, [](int key, int value){
+            return pack_key_value(key, value);
+        });
+    }
+
+    // one fused pass that writes both output vectors
+    void unpack_key_values(const uint64_t* packed, std::vector<int> &values, std::vector<int> &keys){
+        long int N = keys.size();
+        #pragma omp parallel for simd schedule(static)
+        for(long int i = 0; i < N; i++){
+            keys[i]   = unpacked_key(packed[i]);
+            values[i] = unpacked_value(packed[i]);
+        }
+    }
+
+    float sort_PACKED64(std::vector<int> &values, std::vector<int> &keys, SortWorkspace &ws){
+        //--- Init ---//
+        long int N = keys.size();
+        std::vector<uint64_t>& packed = ws.buffer<uint64_t>(0, N);
+
+        //--- Operations - time measuring starts ---//
+        auto t_begin = std::chrono::high_resolution_clock::now();
+
+        pack_key_values(values, keys, packed.data());
+        std::sort(std::execution::par_unseq, packed.begin(), packed.end());  // plain integer compare, no branches
+        unpack_key_values(packed.data(), values, keys);
+
+        auto t_end = std::chrono::high_resolution_clock::now();
+        float time = std::chrono::duration_cast<time_unit_t2>(t_end-t_begin).count();
+        return time;
+    }
+    float sort_PACKED64(std::vector<int> &values, std::vector<int> &keys){
+        SortWorkspace ws;
+        return sort_PACKED64(values, keys, ws);
+    }
+
+    // packed keys fed to the radix engine - keys and values must be non-negative
+    float sort_PACKED64_RADIX(std::vector<int> &values, std::vector<int> &keys, SortWorkspace &ws){
+        //--- Init ---//
+        long int N = keys.size();
+        std::vector<uint64_t>& packed = ws.buffer<uint64_t>(0, N);
+        std::vector<uint64_t>& tmp = ws.buffer<uint64_t>(1, N);
+
+        //--- Operations - time measuring starts ---//
+        auto t_begin = std::chrono::high_resolution_clock::now();
+
+        if(N > 0){
+            pack_key_values(values, keys, packed.data());
+            // low (value) digits - not needed if the values are already in order, as the passes are stable
+            if(!std::is_sorted(std::execution::par, values.begin(), values.end())){
+                int maxValue = *std::max_element(std::execution::par, values.begin(), values.end());
+                radix_sort(packed.data(), (int*)nullptr, tmp.data(), (int*)nullptr, N, 0, bit_width(maxValue));
+            }
+            // high (key) digits
+            int maxKey = *std::max_element(std::execution::par, keys.begin(), keys.end());
+            radix_sort(packed.data(), (int*)nullptr, tmp.data(), (int*)nullptr, N, 32, 32 + bit_width(maxKey));
+            unpack_key_values(packed.data(), values, keys);
+        }
+
+        auto t_end = std::chrono::high_resolution_clock::now();
+        float time = std::chrono::duration_cast<time_unit_t2>(t_end-t_begin).count();
+        return time;
+    }
+    float sort_PACKED64_RADIX(std::vector<int> &values, std::vector<int> &keys){
+        SortWorkspace ws;
+        return sort_PACKED64_RADIX(values, keys, ws);
+    }
+
+
+    // packed pairs, parallel merge sort: SIMD sorting network (simdsort.h) on the leaf blocks, then parallel merge rounds
+    float sort_PACKED64_MERGE(std::vector<int> &values, std::vector<int> &keys, SortWorkspace &ws){
+        //--- Init ---//
+        long int N = keys.size();
+        long int B = simdsort::MAX_BLOCK;
+        long int blocks = (N + B - 1) / B;
+        std::vector<uint64_t>& packed = ws.buffer<uint64_t>(0, N);
+        std::vector<uint64_t>& tmp = ws.buffer<uint64_t>(1, N);
+        std::vector<long int>& runStarts = ws.buffer<long int>(1, blocks + 1);
+
+        //--- Operations - time measuring starts ---//
+        auto t_begin = std::chrono::high_resolution_clock::now();
+
+        pack_key_values(values, keys, packed.data());
+
+        // base case: sorting network per block
+        #pragma omp parallel for schedule(static)
+        for(long int b = 0; b < blocks; b++){
+            simdsort::sort_block(packed.data() + b * B, (int)std::min(B, N - b * B));
+            runStarts[b] = b * B;
+        }
+        runStarts[blocks] = N;
+
+        uint64_t* src = packed.data();
+        uint64_t* dst = tmp.data();
+        while(runStarts.size() > 2){
+            merging::merge_runs_round(src, dst, runStarts, std::less<uint64_t>());
+            std::swap(src, dst);
+        }
+        unpack_key_values(src, values, keys);
+
+        auto t_end = std::chrono::high_resolution_clock::now();
+        float time = std::chrono::duration_cast<time_unit_t2>(t_end-t_begin).count();
+        return time;
+    }
+    float sort_PACKED64_MERGE(std::vector<int> &values, std::vector<int> &keys){
+        SortWorkspace ws;
+        return sort_PACKED64_MERGE(values, keys, ws);
+    }
+
+
+    // ADAPTIVE (run-aware) sort by 1. keys 2. values, for nearly sorted input (e.g. the previous grouping after a tick)
+    //  1. the presorted runs are detected in parallel (descents of the packed key/value sequence)
+    //  2. too little order (average run shorter than minAvgRun) -> full sort (sort_PACKED64_RADIX)
+    //     otherwise the runs are merged pairwise in log2(runs) rounds with parallel (merge path) merges
+    const long int ADAPTIVE_MIN_AVG_RUN = 64;
+
+    float sort_ADAPTIVE(std::vector<int> &values, std::vector<int> &keys, SortWorkspace &ws, long int minAvgRun = ADAPTIVE_MIN_AVG_RUN){
+        //--- Init ---//
+        long int N = keys.size();
+        int T = max_threads();
+        std::vector<uint64_t>& packed = ws.buffer<uint64_t>(0, N);
+        std::vector<uint64_t>& tmp = ws.buffer<uint64_t>(1, N);
+        std::vector<long int>& chunkDescents = ws.buffer<long int>(0, T + 1);
+        std::fill(chunkDescents.begin(), chunkDescents.end(), 0);
+
+        //--- Operations - time measuring starts ---//
+        auto t_begin = std::chrono::high_resolution_clock::now();
+
+        pack_key_values(values, keys, packed.data());
+
+        // 1. count the descents (= run starts except the first) per chunk
+        #pragma omp parallel num_threads(T)
+        {
+            int t = thread_num();
+            int nt = num_threads();
+            long int begin = std::max(1L, N * t / nt);
+            long int end   = N * (t+1) / nt;
+            long int count = 0;
+            for(long int i = begin; i < end; i++)
+                count += packed[i] < packed[i-1];
+            chunkDescents[t + 1] = count;
+        }
+        for(int t = 0; t < T; t++)
+            chunkDescents[t + 1] += chunkDescents[t];
+        long int R = chunkDescents[T] + 1;  // number of runs
+
+        if(R == 1){
+            // already sorted
+        }
+        else if(R > N / minAvgRun){
+            sort_PACKED64_RADIX(values, keys, ws);
+        }
+        else{
+            // 2. run starts, every chunk writes its own descents
+            std::vector<long int>& runStarts = ws.buffer<long int>(1, R + 1);
+            runStarts[0] = 0;
+            runStarts[R] = N;
+            #pragma omp parallel num_threads(T)
+            {
+                int t = thread_num();
+                int nt = num_threads();
+                long int begin = std::max(1L, N * t / nt);
+                long int end   = N * (t+1) / nt;
+                long int r = chunkDescents[t] + 1;
+                for(long int i = begin; i < end; i++)
+                    if(packed[i] < packed[i-1])
+                        runStarts[r++] = i;
+            }
+
+            // 3. merge rounds, ping-pong between the two buffers
+            uint64_t* src = packed.data();
+            uint64_t* dst = tmp.data();
+            while(runStarts.size() > 2){
+                merging::merge_runs_round(src, dst, runStarts, std::less<uint64_t>());
+                std::swap(src, dst);
+            }
+            unpack_key_values(src, values, keys);
+        }
+
+        auto t_end = std::chrono::high_resolution_clock::now();
+        float time = std::chrono::duration_cast<time_unit_t2>(t_end-t_begin).count();
+        return time;
+    }
+    float sort_ADAPTIVE(std::vector<int> &values, std::vector<int> &keys){
+        SortWorkspace ws;
+        return sort_ADAPTIVE(values, keys, ws);
+    }
+
+
+    // histogram -> keyPtrs -> stable scatter, the core of the counting sorts: key(i) is the key of element i in [0, N),
+    // emit(i, dst) moves element i to dst. Scratch: per-thread histograms (threads * keyN ints), no N-sized buffer
+    template<typename Key, typename Emit>
+    void counting_scatter(long int N, std::vector<int> &keyPtrs, SortWorkspace &ws, Key key, Emit emit){
+        int K = keyPtrs.size();
+        int T = max_threads();
+        std::vector<int>& hist = ws.buffer<int>(2, (long int)T * K);  // per-thread histograms, later the per-thread scatter offsets
+        std::vector<long int>& chunkSums = ws.buffer<long int>(0, T + 1);
+
+        #pragma omp parallel num_threads(T)
+        {
+            int t = thread_num();
+            int nt = num_threads();
+            long int begin = N * t / nt;
+            long int end   = N * (t+1) / nt;
+            int* h = &hist[(long int)t * K];
+
+            // 1. per-thread key histograms
+            std::fill(h, h + K, 0);
+            for(long int i = begin; i < end; i++)
+                h[key(i)]++;
+            #pragma omp barrier
+
+            // 2. per key: offsets of the threads inside the key's bucket, the bucket size goes to keyPtrs
+            #pragma omp for
+            for(int k = 0; k < K; k++){
+                int sum = 0;
+                for(int tt = 0; tt < nt; tt++){
+                    int count = hist[(long int)tt * K + k];
+                    hist[(long int)tt * K + k] = sum;
+                    sum += count;
+                }
+                keyPtrs[k] = sum;
+            }
+
+            // 3. exclusive scan of the bucket sizes -> keyPtrs (blocked: chunk sums, then the chunks)
+            int kBegin = (long int)K * t / nt;
+            int kEnd   = (long int)K * (t+1) / nt;
+            long int chunkSum = 0;
+            for(int k = kBegin; k < kEnd; k++)
+                chunkSum += keyPtrs[k];
+            chunkSums[t + 1] = chunkSum;
+            #pragma omp barrier
+            #pragma omp single
+            {
+                chunkSums[0] = 0;
+                for(int tt = 0; tt < nt; tt++)
+                    chunkSums[tt + 1] += chunkSums[tt];
+            }
+            int running = chunkSums[t];
+            for(int k = kBegin; k < kEnd; k++){
+                int count = keyPtrs[k];
+                keyPtrs[k] = running;
+                running += count;
+            }
+            #pragma omp barrier
+
+            // 4. stable scatter
+            for(long int i = begin; i < end; i++){
+                int k = key(i);
+                emit(i, keyPtrs[k] + h[k]++);
+            }
+        }
+    }
+
+    // counting sort by 1. keys 2. values that emits the keyPtrs (CSR offsets) as well - replaces sort_* + generateKeyPtrs
+    // keyPtrs.size() = keyN + 1, keys must be in [0, keyN)
+    float sort_COUNTING_WITH_PTRS(std::vector<int> &values, std::vector<int> &keys, std::vector<int> &keyPtrs, SortWorkspace &ws){
+        //--- Init ---//
+        long int N = keys.size();
+        std::vector<int>& sorted_keys = ws.buffer<int>(0, N);
+        std::vector<int>& sorted_values = ws.buffer<int>(1, N);
+
+        //--- Operations - time measuring starts ---//
+        auto t_begin = std::chrono::high_resolution_clock::now();
+
+        // the scatter is stable, so the agent order only has to be established if the input is not already sorted by values
+        if(N > 0 && !std::is_sorted(std::execution::par, values.begin(), values.end())){
+            int maxValue = *std::max_element(std::execution::par, values.begin(), values.end());
+            radix_sort(values.data(), keys.data(), sorted_values.data(), sorted_keys.data(), N, 0, bit_width(maxValue));
+        }
+
+        int* keys_ = keys.data();
+        int* values_ = values.data();
+        int* sortedKeys_ = sorted_keys.data();
+        int* sortedValues_ = sorted_values.data();
+        counting_scatter(N, keyPtrs, ws, [=](long int i){ return keys_[i]; }, [=](long int i, long int dst){
+            sortedKeys_[dst] = keys_[i];
+            sortedValues_[dst] = values_[i];
+        });
+
+        keys.swap(sorted_keys);
+        values.swap(sorted_values);
+
+        auto t_end = std::chrono::high_resolution_clock::now();
+        float time = std::chrono::duration_cast<time_unit_t2>(t_end-t_begin).count();
+        return time;
+    }
+    float sort_COUNTING_WITH_PTRS(std::vector<int> &values, std::vector<int> &keys, std::vector<int> &keyPtrs){
+        SortWorkspace ws;
+        return sort_COUNTING_WITH_PTRS(values, keys, keyPtrs, ws);
+    }
+
+    // IDs 0 .. N-1 grouped by keyOfId (ids sorted by 1. key 2. ID) + keyPtrs, straight from the ID -> key array:
+    // no key column is sorted, so there is no N-sized scratch (only the histograms) - the sorted keys are keyPtrs expanded
+    float sort_COUNTING_IDS_WITH_PTRS(const std::vector<int> &keyOfId, std::vector<int> &ids, std::vector<int> &keyPtrs, SortWorkspace &ws){
+        auto t_begin = std::chrono::high_resolution_clock::now();
+
+        long int N = keyOfId.size();
+        ids.resize(N);
+        const int* keyOfId_ = keyOfId.data();
+        int* ids_ = ids.data();
+        counting_scatter(N, keyPtrs, ws, [=](long int i){ return keyOfId_[i]; }, [=](long int i, long int dst){
+            ids_[dst] = (int)i;
+        });
+
+        auto t_end = std::chrono::high_resolution_clock::now();
+        float time = std::chrono::duration_cast<time_unit_t2>(t_end-t_begin).count();
+        return time;
+    }
+
+
+    //---------------- TWO LEVEL keys ----------------------------
+    //  (primary, secondary) -> composite key primary * secondaryN + secondary, so sorting by the composite key sorts by
+    //  1. primary 2. secondary, and its keyPtrs are nested offsets: with K = secondaryN
+    //   - the elements of (p, s) are [nestedPtrs[p*K + s], nestedPtrs[p*K + s + 1])
+    //   - the elements of p are       [nestedPtrs[p*K], nestedPtrs[(p+1)*K])
+    //  primaryN * secondaryN must fit in an int
+
+    inline int composite_key(int primary, int secondary, int secondaryN){ return primary * secondaryN + secondary; }
+
+    // primaryPtrs[p] = nestedPtrs[p * secondaryN]  (strided gather, primaryPtrs.size() = primaryN + 1)
+    float generatePrimaryKeyPtrs(const std::vector<int>& nestedPtrs, int secondaryN, std::vector<int>& primaryPtrs){
+        auto t_begin = std::chrono::high_resolution_clock::now();
+        long int primaryN = (nestedPtrs.size() - 1) / secondaryN;
+        primaryPtrs.resize(primaryN + 1);
+        #pragma omp parallel for schedule(static)
+        for(long int p = 0; p <= primaryN; p++)
+            primaryPtrs[p] = nestedPtrs[p * secondaryN];
+        auto t_end = std::chrono::high_resolution_clock::now();
+        float time = std::chrono::duration_cast<time_unit_t2>(t_end-t_begin).count();
+        return time;
+    }
+
+    // sorts values by 1. primaryKeys 2. secondaryKeys 3. values (all three are permuted), nestedPtrs.size() = primaryN * secondaryN + 1
+    float sort_TWO_LEVEL(std::vector<int> &values, std::vector<int> &primaryKeys, std::vector<int> &secondaryKeys, int secondaryN,
+                         std::vector<int> &nestedPtrs, SortWorkspace &ws){
+        auto t_begin = std::chrono::high_resolution_clock::now();
+        long int N = values.size();
+        std::vector<int>& keys = ws.buffer<int>(3, N);  // slots 0 - 2: sort_COUNTING_WITH_PTRS
+        std::transform(std::execution::par_unseq, primaryKeys.begin(), primaryKeys.end(), secondaryKeys.begin(), keys.begin(), [=](int primary, int secondary){
+            return composite_key(primary, secondary, secondaryN);
+        });
+        sort_COUNTING_WITH_PTRS(values, keys, nestedPtrs, ws);
+        #pragma omp parallel for simd schedule(static)
+        for(long int i = 0; i < N; i++){
+            primaryKeys[i]   = keys[i] / secondaryN;
+            secondaryKeys[i] = keys[i] % secondaryN;
+        }
+        auto t_end = std::chrono::high_resolution_clock::now();
+        float time = std::chrono::duration_cast<time_unit_t2>(t_end-t_begin).count();
+        return time;
+    }
+    float sort_TWO_LEVEL(std::vector<int> &values, std::vector<int> &primaryKeys, std::vector<int> &secondaryKeys, int secondaryN,
+                         std::vector<int> &nestedPtrs){
+        SortWorkspace ws;
+        return sort_TWO_LEVEL(values, primaryKeys, secondaryKeys, secondaryN, nestedPtrs, ws);
+    }
+
+
+    //---------------- GENERIC sort_by_key ----------------------------
+    //  sort_by_key(policy, keys, vals, keyN): stable sort of vals by keys (equal keys keep their input order - with agents
+    //  from iota this is the same as sorting by 1. keys 2. values). keyN > 0 means keys in [0, keyN), 0 = unknown range.
+    //   - integral keys: radix engine, threads from the policy (seq / unseq -> 1 thread); if keyN fits in 16 bits the
+    //     passes move uint16_t copies of the keys instead of the full keys
+    //   - other (or negative) keys: stable comparison argsort with the policy + one gather of both columns
+    //  the scratch buffers come from a SortWorkspace (sort_by_key(policy, keys, vals, keyN, ws)), like in the other sort_*
+
+    template<class Policy>
+    struct is_parallel_policy : std::integral_constant<bool,
+        std::is_same<typename std::decay<Policy>::type, std::execution::parallel_policy>::value ||
+        std::is_same<typename std::decay<Policy>::type, std::execution::parallel_unsequenced_policy>::value>{};
+
+    // n elements of any trivially copyable T (alignment <= 8) in a uint64_t slot of the workspace
+    template<class T>
+    T* scratch(SortWorkspace& ws, std::size_t slot, long int n){
+        static_assert(std::is_trivially_copyable<T>::value && alignof(T) <= alignof(uint64_t), "scratch: unsupported type");
+        return reinterpret_cast<T*>(ws.buffer<uint64_t>(slot, (n * sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t)).data());
+    }
+
+    template<class Policy, class K, class V>
+    void sort_by_key_COMPARISON(Policy&& policy, span<K> keys, span<V> vals, SortWorkspace& ws){
+        long int N = keys.size();
+        std::vector<int>& indices = ws.buffer<int>(0, N);
+        K* sorted_keys = scratch<K>(ws, 0, N);
+        V* sorted_vals = scratch<V>(ws, 1, N);
+        std::iota(indices.begin(), indices.end(), 0);
+        K* key_ptr = keys.data();
+        std::stable_sort(policy, indices.begin(), indices.end(), [=](int a, int b){
+            return key_ptr[a] < key_ptr[b];
+        });
+        permutation::gather(indices.data(), N, std::make_tuple(keys.data(), vals.data()), std::make_tuple(sorted_keys, sorted_vals));
+        std::copy(policy, sorted_keys, sorted_keys + N, keys.begin());
+        std::copy(policy, sorted_vals, sorted_vals + N, vals.begin());
+    }
+
+    template<class Policy, class K, class V>
+    void sort_by_key_RADIX(Policy&& policy, span<K> keys, span<V> vals, long int keyN, SortWorkspace& ws){
+        long int N = keys.size();
+        int nThreads = is_parallel_policy<Policy>::value ? max_threads() : 1;
+        V* tmp_vals = scratch<V>(ws, 0, N);
+        if(keyN > 0 && keyN <= (1 << 16) && sizeof(K) > sizeof(uint16_t)){
+            // narrow keys: half (or less) of the key bandwidth in every pass
+            uint16_t* narrow_keys = scratch<uint16_t>(ws, 1, N);
+            uint16_t* tmp_keys = scratch<uint16_t>(ws, 2, N);
+            std::transform(policy, keys.begin(), keys.end(), narrow_keys, [](K key){ return (uint16_t)key; });
+            radix_sort(narrow_keys, vals.data(), tmp_keys, tmp_vals, N, 0, bit_width(keyN - 1), nThreads);
+            std::transform(policy, narrow_keys, narrow_keys + N, keys.begin(), [](uint16_t key){ return (K)key; });
+        }
+        else{
+            using UK = typename std::make_unsigned<K>::type;
+            UK maxKey = keyN > 0 ? (UK)(keyN - 1) : (UK)*std::max_element(policy, keys.begin(), keys.end());
+            K* tmp_keys = scratch<K>(ws, 1, N);
+            radix_sort(keys.data(), vals.data(), tmp_keys, tmp_vals, N, 0, bit_width(maxKey), nThreads);
+        }
+    }
+
+    template<class Policy, class K, class V>
+    float sort_by_key(Policy&& policy, span<K> keys, span<V> vals, long int keyN, SortWorkspace& ws){
+        auto t_begin = std::chrono::high_resolution_clock::now();
+
+        if(keys.size() > 1){
+            if constexpr (std::is_integral<K>::value){
+                bool negative = false;
+                if(std::is_signed<K>::value)
+                    negative = *std::min_element(policy, keys.begin(), keys.end()) < 0;
+                if(!negative)
+                    sort_by_key_RADIX(policy, keys, vals, keyN, ws);
+                else
+                    sort_by_key_COMPARISON(policy, keys, vals, ws);
+            }
+            else{
+                sort_by_key_COMPARISON(policy, keys, vals, ws);
+            }
+        }
+
+        auto t_end = std::chrono::high_resolution_clock::now();
+        float time = std::chrono::duration_cast<time_unit_t2>(t_end-t_begin).count();
+        return time;
+    }
+    template<class Policy, class K, class V>
+    float sort_by_key(Policy&& policy, span<K> keys, span<V> vals, long int keyN = 0){
+        SortWorkspace ws;
+        return sort_by_key(policy, keys, vals, keyN, ws);
+    }
+
 
     // runs on CPU but on GPU compilation error
     float sort_HELPER_INDICES_2(std::vector<int> &values, std::vector<int> &keys){
@@ -183,10 +869,25 @@ namespace sorting{
     }
 
 
-    // TODO sort by both 1. keys and 2. values
+    // sorts the two vectors in place through a proxy (zip) iterator - no pair vector, no transforms
     float sort_PAIRED_VECTOR_ITERATOR(std::vector<int> &values, std::vector<int> &keys){
-        // todo with my paired vector iterator
-        return 0;
+        //--- Init ---//
+        long int N = keys.size();
+        PairedVectorIterator begin(0, keys, values);
+        PairedVectorIterator end(N, keys, values);
+
+        //--- Operations - time measuring starts ---//
+        auto t_begin = std::chrono::high_resolution_clock::now();
+
+        std::sort(std::execution::par, begin, end, [](PairedValue p1, PairedValue p2){
+            if (p1.key == p2.key)
+                return p1.val < p2.val;
+            return p1.key < p2.key;
+        });
+
+        auto t_end = std::chrono::high_resolution_clock::now();
+        float time = std::chrono::duration_cast<time_unit_t2>(t_end-t_begin).count();
+        return time;
     }
 
 
@@ -0,0 +1,45 @@
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <vector>
+#include <cstddef>
+#include <type_traits>
+
+namespace sorting{
+
+    // non-owning view of a contiguous array (C++17 has no std::span yet)
+    template<typename T>
+    class span{
+        T* _data;
+        std::size_t _size;
+
+    public:
+        using element_type = T;
+        using value_type = typename std::remove_cv<T>::type;
+        using iterator = T*;
+
+        span() : _data(nullptr), _size(0){}
+        span(T* data, std::size_t size) : _data(data), _size(size){}
+
+        template<typename U, typename = typename std::enable_if<std::is_convertible<U(*)[], T(*)[]>::value>::type>
+        span(std::vector<U>& v) : _data(v.data()), _size(v.size()){}
+
+        template<typename U, typename = typename std::enable_if<std::is_convertible<const U(*)[], T(*)[]>::value>::type>
+        span(const std::vector<U>& v) : _data(v.data()), _size(v.size()){}
+
+        template<typename U, typename = typename std::enable_if<std::is_convertible<U(*)[], T(*)[]>::value>::type>
+        span(const span<U>& other) : _data(other.data()), _size(other.size()){}
+
+        T* data() const{ return _data; }
+        std::size_t size() const{ return _size; }
+        bool empty() const{ return _size == 0; }
+        T* begin() const{ return _data; }
+        T* end() const{ return _data + _size; }
+        T& operator[](std::size_t i) const{ return _data[i]; }
+
+        span subspan(std::size_t offset, std::size_t count) const{ return span(_data + offset, count); }
+    };
+
+} // namespace sorting
+
+#endif //SPAN_H
@@ -2,6 +2,8 @@
 #define STATISTICS_H
 
 #include <vector>
+#include <algorithm>
+#include <cmath>
 
 template<typename T>
 T avg(std::vector<T> input){
@@ -24,5 +26,17 @@ T std_dev(std::vector<T> input){
     return std_dev;
 }
 
+// nearest rank: the smallest element that at least p percent of the elements are not greater than (p = 100: the maximum),
+// T() for an empty input
+template<typename T>
+T percentile(std::vector<T> input, double p){
+    if(input.empty())
+        return T();
+    long int rank = (long int)std::ceil(p / 100.0 * input.size());
+    long int k = std::min<long int>(std::max<long int>(rank, 1), input.size()) - 1;
+    std::nth_element(input.begin(), input.begin() + k, input.end());
+    return input[k];
+}
+
 
 #endif //STATISTICS_H
@@ -0,0 +1,136 @@
+#ifndef TWO_LEVEL_INDEX_H
+#define TWO_LEVEL_INDEX_H
+
+#ifndef GPU
+// for CPU:
+#include <pstl/algorithm>
+#include <pstl/execution>
+#else
+// for GPU:
+#include <algorithm>
+#include <execution>
+#endif
+
+#include <vector>
+
+#include "locchange.h"
+#include "locationindex.h"
+#include "compaction.h"
+#include "workspace.h"
+#include "span.h"
+
+// agents grouped by 1. location 2. state (infection state, age band, ...): a LocationIndex over the composite key
+// location * stateN + state (sorting::composite_key), so its locPtrs are nested offsets
+//  nestedPtrs() - the agents of (l, s) are agents()[nestedPtrs()[l*stateN + s], nestedPtrs()[l*stateN + s + 1])
+//  agents_at(l) - agents()[nestedPtrs()[l*stateN], nestedPtrs()[(l+1)*stateN])
+// apply(locChanges, stateChanges): both are LocChanges (from/to are locations resp. states), an agent can be in both.
+//  They are turned into one batch of composite key changes. A state-only change moves the agent inside the range of its
+//  location, the location level offsets (nestedPtrs()[l*stateN]) stay the same, and only the nested offsets between the
+//  lowest and the highest touched (location, state) are updated (not all locN * stateN of them).
+class TwoLevelIndex{
+    int _locN = 0;
+    int _stateN = 0;
+
+    std::vector<int> _stateOfAgent;
+    std::vector<int> _changeOfAgent;    // index of the agent's location change in the current batch, -1 otherwise
+    std::vector<LocChange> _changes;    // composite key changes of the current batch
+    LocationIndex _index;
+
+    Workspace<int> _ws;
+
+public:
+    TwoLevelIndex(){}
+
+    TwoLevelIndex(sorting::span<const int> locationOfAgent, sorting::span<const int> stateOfAgent, int locN, int stateN,
+                  LocationIndex::UpdateAlg updateAlg = LocationIndex::UPDATE_MERGE){
+        _index.set_update_alg(updateAlg);
+        build(locationOfAgent, stateOfAgent, locN, stateN);
+    }
+
+    void build(sorting::span<const int> locationOfAgent, sorting::span<const int> stateOfAgent, int locN, int stateN){
+        long int agentN = locationOfAgent.size();
+        _locN = locN;
+        _stateN = stateN;
+        _stateOfAgent.assign(stateOfAgent.begin(), stateOfAgent.end());
+        _changeOfAgent.assign(agentN, -1);
+        std::vector<int>& keys = _ws.buffer<int>(0, agentN);
+        std::transform(std::execution::par_unseq, locationOfAgent.begin(), locationOfAgent.end(), stateOfAgent.begin(), keys.begin(), [=](int loc, int state){
+            return sorting::composite_key(loc, state, stateN);
+        });
+        _index.build(keys, locN * stateN);
+    }
+
+    // locChanges:   every agent at most once, from = the current location, from != to
+    // stateChanges: every agent at most once, from = the current state, from != to
+    LocationIndex::UpdateTimes apply(sorting::span<const LocChange> locChanges, sorting::span<const LocChange> stateChanges){
+        long int locChangeN = locChanges.size();
+        long int stateChangeN = stateChanges.size();
+        int stateN = _stateN;
+
+        #pragma omp parallel for schedule(static)
+        for(long int c = 0; c < locChangeN; c++)
+            _changeOfAgent[locChanges[c].agent] = c;
+
+        // state changes of agents that don't change location: compacted after the location changes
+        std::vector<int>& stateOnly = _ws.buffer<int>(1, stateChangeN);
+        std::vector<int>& ranks     = _ws.buffer<int>(2, stateChangeN);
+        #pragma omp parallel for schedule(static)
+        for(long int s = 0; s < stateChangeN; s++)
+            stateOnly[s] = _changeOfAgent[stateChanges[s].agent] < 0;
+        long int stateOnlyN = compaction::keep_ranks(stateOnly.data(), ranks.data(), stateChangeN);
+
+        _changes.resize(locChangeN + stateOnlyN);
+        #pragma omp parallel for schedule(static)
+        for(long int c = 0; c < locChangeN; c++){
+            const LocChange& lch = locChanges[c];
+            int state = _stateOfAgent[lch.agent];
+            _changes[c] = LocChange(lch.agent, sorting::composite_key(lch.from, state, stateN), sorting::composite_key(lch.to, state, stateN));
+        }
+        #pragma omp parallel for schedule(static)
+        for(long int s = 0; s < stateChangeN; s++){
+            const LocChange& sch = stateChanges[s];
+            long int c = _changeOfAgent[sch.agent];
+            if(c >= 0)
+                _changes[c].to = sorting::composite_key(locChanges[c].to, sch.to, stateN);
+            else{
+                int loc = location_of(sch.agent);
+                _changes[locChangeN + ranks[s]] = LocChange(sch.agent, sorting::composite_key(loc, sch.from, stateN), sorting::composite_key(loc, sch.to, stateN));
+            }
+        }
+
+        #pragma omp parallel for schedule(static)
+        for(long int c = 0; c < locChangeN; c++)
+            _changeOfAgent[locChanges[c].agent] = -1;
+        #pragma omp parallel for schedule(static)
+        for(long int s = 0; s < stateChangeN; s++)
+            _stateOfAgent[stateChanges[s].agent] = stateChanges[s].to;
+
+        sort_loc_changes(_changes);
+        return _index.apply(_changes);
+    }
+
+    int locN() const{ return _locN; }
+    int stateN() const{ return _stateN; }
+    const std::vector<int>& agents() const{ return _index.agents(); }
+    const std::vector<int>& nestedPtrs() const{ return _index.locPtrs(); }
+    const LocationIndex& index() const{ return _index; }
+
+    int location_of(int agent) const{ return _index.location_of(agent) / _stateN; }
+    int state_of(int agent) const{ return _stateOfAgent[agent]; }
+    int position_of(int agent) const{ return _index.position_of(agent); }
+
+    sorting::span<const int> agents_at(int loc) const{
+        const std::vector<int>& ptrs = nestedPtrs();
+        return sorting::span<const int>(agents().data() + ptrs[loc * _stateN], ptrs[(loc+1) * _stateN] - ptrs[loc * _stateN]);
+    }
+    sorting::span<const int> agents_at(int loc, int state) const{
+        return _index.agents_at(sorting::composite_key(loc, state, _stateN));
+    }
+
+    // location level offsets: the agents of l are agents()[locPtrs[l], locPtrs[l+1])
+    void location_ptrs(std::vector<int>& locPtrs) const{
+        sorting::generatePrimaryKeyPtrs(nestedPtrs(), _stateN, locPtrs);
+    }
+};
+
+#endif //TWO_LEVEL_INDEX_H
@@ -0,0 +1,55 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <vector>
+#include <deque>
+#include <tuple>
+#include <algorithm>
+#include <cstddef>
+
+// Scratch buffers that outlive one sort / update call.
+//  buffer<T>(slot, n) returns the slot-th scratch vector of type T with size n. The capacity only grows (geometrically),
+//  so in a per-tick loop with the same sizes there are no allocations, page faults and zero-fills after the first tick.
+//  The contents are unspecified - whatever the previous user left there (or the caller's old vector, if it was swapped in).
+template<typename... Ts>
+class Workspace{
+    std::tuple<std::deque<std::vector<Ts>>...> _buffers;  // deque: growing the slot list doesn't move the handed out vectors
+
+public:
+    template<typename T>
+    std::vector<T>& buffer(std::size_t slot, std::size_t n){
+        std::deque<std::vector<T>>& slots = std::get<std::deque<std::vector<T>>>(_buffers);
+        if(slots.size() <= slot)
+            slots.resize(slot + 1);
+        std::vector<T>& buf = slots[slot];
+        if(buf.capacity() < n)
+            buf.reserve(std::max(n, 2 * buf.capacity()));
+        buf.resize(n);
+        return buf;
+    }
+
+    std::size_t bytes() const{
+        std::size_t sum = 0;
+        std::apply([&](const auto&... slotLists){
+            ((sum += bytes(slotLists)), ...);
+        }, _buffers);
+        return sum;
+    }
+
+    void release(){
+        std::apply([](auto&... slotLists){
+            (slotLists.clear(), ...);
+        }, _buffers);
+    }
+
+private:
+    template<typename T>
+    static std::size_t bytes(const std::deque<std::vector<T>>& slots){
+        std::size_t sum = 0;
+        for(const std::vector<T>& buf : slots)
+            sum += buf.capacity() * sizeof(T);
+        return sum;
+    }
+};
+
+#endif //WORKSPACE_H